@@ -0,0 +1,95 @@
+#include "PathingMap.h"
+#include "RandomGenerator.h"
+#include "Vendor.h"
+
+using namespace cute;
+
+/// Compares PathingMap::can_fit() (shifted row masks, or per-row counts for different cell sizes) with the
+/// rect-based test it replaced, for random PathingMaps placed at random positions: on cell corners and in
+/// between, partly outside of the map, with the same and with different cell sizes.
+
+namespace {
+
+/// The previous PathingMap::can_fit(): shifts a rect per filled cell of `pm` and looks at every cell of `map`
+/// under it.
+bool rect_based_can_fit(const PathingMap &map, const PathingMap &pm, const QPointF &pos) {
+    if (!map.contains(pos)) {
+        return false;
+    }
+    for (QRectF rect : pm.cells_as_rects()) {
+        if (!pm.filled(rect)) {
+            continue;
+        }
+        rect.moveTopLeft(QPointF(pos.x() + rect.x(), pos.y() + rect.y()));
+        for (const Node &cell : map.cells(rect)) {
+            if (map.filled(cell)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void fill_randomly(PathingMap &pm, int fill_percent) {
+    for (const Node &cell : pm.cells()) {
+        if (common_random_generator.rand_int(1, 100) <= fill_percent) {
+            pm.fill(cell);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    unsigned seed = (argc > 1) ? static_cast<unsigned>(atoi(argv[1])) : 1;
+    srand(seed);
+
+    const int cell_sizes[] = {8, 16, 32};
+    int num_compared = 0;
+    int num_fits = 0;
+    for (int round = 0; round < 400; round++) {
+        int cell_size = cell_sizes[common_random_generator.rand_int(0, 2)];
+        /// wide enough that the rows take more than one 64 cell word
+        PathingMap map(common_random_generator.rand_int(1, 150), common_random_generator.rand_int(1, 40), cell_size);
+        fill_randomly(map, common_random_generator.rand_int(0, 15));
+
+        for (int probe = 0; probe < 20; probe++) {
+            int probe_cell_size = cell_size;
+            if (common_random_generator.rand_int(0, 2) == 0) {
+                probe_cell_size = cell_sizes[common_random_generator.rand_int(0, 2)];
+            }
+            PathingMap pm(common_random_generator.rand_int(1, 70), common_random_generator.rand_int(1, 6),
+                          probe_cell_size);
+            fill_randomly(pm, common_random_generator.rand_int(0, 60));
+
+            for (int placement = 0; placement < 10; placement++) {
+                /// a cell corner, a whole pixel or anywhere
+                double x = common_random_generator.rand_int(-1, map.num_cells_wide()) * cell_size;
+                double y = common_random_generator.rand_int(-1, map.num_cells_long()) * cell_size;
+                int kind = common_random_generator.rand_int(0, 2);
+                if (kind >= 1) {
+                    x += common_random_generator.rand_int(0, cell_size - 1);
+                    y += common_random_generator.rand_int(0, cell_size - 1);
+                }
+                if (kind == 2) {
+                    x += common_random_generator.rand_int(0, 99) / 100.0;
+                    y += common_random_generator.rand_int(0, 99) / 100.0;
+                }
+                QPointF pos(x, y);
+
+                bool fits = map.can_fit(pm, pos);
+                if (fits != rect_based_can_fit(map, pm, pos)) {
+                    qCritical() << "PathingMap::can_fit() differs from the rect-based test, seed" << seed << "round"
+                                << round << "at" << x << y << "cell sizes" << cell_size << probe_cell_size;
+                    return 1;
+                }
+                num_compared++;
+                num_fits += fits;
+            }
+        }
+    }
+
+    qInfo() << "PathingMap::can_fit() matched the rect-based test for" << num_compared << "placements (" << num_fits
+            << "fit)";
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "ConnectedComponents.h"
+#include "PathGrid.h"
+#include "RandomGenerator.h"
+#include "Vendor.h"
+
+using namespace cute;
+
+/// Compares ConnectedComponents kept up to date with fill()/unfill() against ConnectedComponents built from the
+/// changed grid, on random grids where a few cells change at a time. When fill() can't keep the labels (the
+/// cell may have split its area), the labels are built again, like PathingMap does. The two must agree on the
+/// number of areas and on which cells are reachable from which.
+
+namespace {
+
+Node random_cell(const PathGrid &grid) {
+    return Node(common_random_generator.rand_int(0, grid.num_cols() - 1),
+                common_random_generator.rand_int(0, grid.num_rows() - 1));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    unsigned seed = (argc > 1) ? static_cast<unsigned>(atoi(argv[1])) : 1;
+    srand(seed);
+
+    int num_compared = 0;
+    int num_kept = 0;
+    for (int round = 0; round < 1000; round++) {
+        PathGrid grid(common_random_generator.rand_int(1, 24), common_random_generator.rand_int(1, 24));
+        int fill_percent = common_random_generator.rand_int(0, 60);
+        for (const Node &cell : grid.nodes()) {
+            if (common_random_generator.rand_int(1, 100) <= fill_percent) {
+                grid.fill(cell);
+            }
+        }
+
+        ConnectedComponents components(grid);
+        for (int step = 0; step < 50; step++) {
+            for (int i = common_random_generator.rand_int(1, 4); i > 0; i--) {
+                Node cell = random_cell(grid);
+                if (grid.filled(cell)) {
+                    grid.unfill(cell);
+                    components.unfill(grid, cell);
+                } else {
+                    grid.fill(cell);
+                    if (components.fill(cell)) {
+                        num_kept++;
+                    } else {
+                        components = ConnectedComponents(grid);
+                    }
+                }
+            }
+
+            ConnectedComponents expected(grid);
+            bool same = components.num_components() == expected.num_components();
+            std::vector<Node> cells = grid.nodes();
+            for (int i = 0; same && i < 20; i++) {
+                Node from = random_cell(grid);
+                Node to = random_cell(grid);
+                same = components.reachable(from, to) == expected.reachable(from, to);
+            }
+            /// every cell against its right and lower neighbors, so no split or join goes unnoticed
+            for (size_t i = 0; same && i < cells.size(); i++) {
+                Node right(cells[i].x() + 1, cells[i].y());
+                Node below(cells[i].x(), cells[i].y() + 1);
+                if (grid.contains(right)) {
+                    same = components.reachable(cells[i], right) == expected.reachable(cells[i], right);
+                }
+                if (same && grid.contains(below)) {
+                    same = components.reachable(cells[i], below) == expected.reachable(cells[i], below);
+                }
+            }
+            if (!same) {
+                qCritical() << "ConnectedComponents differ from a rebuild, seed" << seed << "round" << round << "step"
+                            << step;
+                return 1;
+            }
+            num_compared++;
+        }
+    }
+
+    qInfo() << "ConnectedComponents matched a rebuild after" << num_compared << "changes (" << num_kept
+            << "fills kept the labels)";
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "IncrementalPathPlanner.h"
+#include "PathGrid.h"
+#include "RandomGenerator.h"
+#include "Vendor.h"
+
+using namespace cute;
+
+/// Compares IncrementalPathPlanner with PathGrid::shortest_path() on random grids, while cells of the grid
+/// change and either end of the path moves (sometimes both). Half of the planners have a small max_expansions,
+/// their searches are resumed until they finish. The paths may differ where there are ties, their costs and
+/// statuses may not.
+
+namespace {
+
+int path_cost(const std::vector<Node> &path) {
+    int cost = 0;
+    for (size_t i = 1; i < path.size(); i++) {
+        bool diagonal = path[i].x() != path[i - 1].x() && path[i].y() != path[i - 1].y();
+        cost += diagonal ? PathingOptions::diagonal_move_cost : PathingOptions::straight_move_cost;
+    }
+    return cost;
+}
+
+/// Returns true if every step of the path is a move the options allow through unfilled cells (the ends may be
+/// filled).
+bool valid_path(const PathGrid &grid, const std::vector<Node> &path, const PathingOptions &options) {
+    for (size_t i = 1; i < path.size(); i++) {
+        int dx = path[i].x() - path[i - 1].x();
+        int dy = path[i].y() - path[i - 1].y();
+        if (abs(dx) > 1 || abs(dy) > 1 || (dx == 0 && dy == 0)) {
+            return false;
+        }
+        if (i + 1 < path.size() && grid.filled(path[i])) {
+            return false;
+        }
+        if (dx != 0 && dy != 0) {
+            if (options.movement == PathingOptions::Movement::FourDirections) {
+                return false;
+            }
+            bool horizontal_free = !grid.filled(path[i - 1].x() + dx, path[i - 1].y());
+            bool vertical_free = !grid.filled(path[i - 1].x(), path[i - 1].y() + dy);
+            bool allowed = options.allow_corner_cutting ? (horizontal_free || vertical_free)
+                                                        : (horizontal_free && vertical_free);
+            if (!allowed) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+Node random_cell(const PathGrid &grid) {
+    return Node(common_random_generator.rand_int(0, grid.num_cols() - 1),
+                common_random_generator.rand_int(0, grid.num_rows() - 1));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    unsigned seed = (argc > 1) ? static_cast<unsigned>(atoi(argv[1])) : 1;
+    srand(seed);
+
+    int num_compared = 0;
+    for (int round = 0; round < 300; round++) {
+        PathGrid grid(common_random_generator.rand_int(2, 40), common_random_generator.rand_int(2, 40));
+        int fill_percent = common_random_generator.rand_int(0, 40);
+        for (const Node &cell : grid.nodes()) {
+            if (common_random_generator.rand_int(1, 100) <= fill_percent) {
+                grid.fill(cell);
+            }
+        }
+
+        PathingOptions options;
+        if (common_random_generator.rand_int(0, 1) == 1) {
+            options.movement = PathingOptions::Movement::EightDirections;
+            options.allow_corner_cutting = common_random_generator.rand_int(0, 1) == 1;
+        }
+        if (common_random_generator.rand_int(0, 1) == 1) {
+            options.max_expansions = common_random_generator.rand_int(1, 50);
+        }
+        PathingOptions unbounded_options = options;
+        unbounded_options.max_expansions = 0;
+
+        IncrementalPathPlanner planner(options);
+        Node from = random_cell(grid);
+        Node to = random_cell(grid);
+        for (int step = 0; step < 30; step++) {
+            for (int i = common_random_generator.rand_int(0, 3); i > 0; i--) {
+                Node cell = random_cell(grid);
+                if (grid.filled(cell)) {
+                    grid.unfill(cell);
+                } else {
+                    grid.fill(cell);
+                }
+            }
+            int moved_ends = common_random_generator.rand_int(0, 3);
+            if (moved_ends == 1 || moved_ends == 3) {
+                from = random_cell(grid);
+            }
+            if (moved_ends == 2 || moved_ends == 3) {
+                to = random_cell(grid);
+            }
+
+            PathStatus status;
+            std::vector<Node> path = planner.shortest_path(grid, from, to, &status);
+            while (status == PathStatus::BudgetExceeded) {
+                path = planner.shortest_path(grid, from, to, &status);
+            }
+            PathStatus expected_status;
+            std::vector<Node> expected_path = grid.shortest_path(from, to, unbounded_options, &expected_status);
+
+            bool same_ends = path.empty() || (path.front() == from && path.back() == to);
+            if (status != expected_status || path.empty() != expected_path.empty() ||
+                path_cost(path) != path_cost(expected_path) || !same_ends || !valid_path(grid, path, options)) {
+                qCritical() << "IncrementalPathPlanner differs from PathGrid::shortest_path(), seed" << seed << "round"
+                            << round << "step" << step << "costs" << path_cost(path) << path_cost(expected_path);
+                return 1;
+            }
+            num_compared++;
+        }
+    }
+
+    qInfo() << "IncrementalPathPlanner matched PathGrid::shortest_path() on" << num_compared << "paths";
+    return 0;
+}
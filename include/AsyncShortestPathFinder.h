@@ -1,6 +1,8 @@
 #pragma once
 
+#include "PathCache.h"
 #include "PathingMap.h"
+#include "PathingOptions.h"
 #include "Vendor.h"
 
 namespace cute {
@@ -9,12 +11,20 @@ class Worker : public QObject {
     Q_OBJECT
 
 public slots:
-    void find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end);
+    void find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end,
+                   const PathingOptions &options);
 
 signals:
-    void path_found(std::vector<QPointF> result);
+    void path_found(std::vector<QPointF> result, PathStatus status);
 };
 
+/// Finds paths in a background thread, path_found() is emitted (in the order the paths were asked for)
+/// with each result and how its search ended (see PathStatus).
+///
+/// Found paths are kept in a PathCache. Asking again for a path between the same cells of an unchanged
+/// PathingMap (same PathingMap::version()) is answered from the cache, without going to the background thread.
+///
+/// Every AsyncShortestPathFinder has a thread of its own, to find paths for many requesters use the PathService.
 class AsyncShortestPathFinder : public QObject {
     Q_OBJECT
 
@@ -22,16 +32,44 @@ public:
     AsyncShortestPathFinder();
     ~AsyncShortestPathFinder();
 
+    void find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end,
+                   const PathingOptions &options = PathingOptions());
+
+    /// number of find_path() requests that were (not) answered from the cache
+    int cache_hits() const { return cache_hits_; }
+    int cache_misses() const { return cache_misses_; }
+
+    void set_cache_capacity(int capacity) { cache_.set_capacity(capacity); }
+    int cache_capacity() const { return cache_.capacity(); }
+
 signals:
-    void path_found(std::vector<QPointF> path);
-    void find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end);
+    void path_found(std::vector<QPointF> path, PathStatus status);
+
+    /// for internal use (hands requests to the worker and cached results back to the event loop)
+    void path_requested(const PathingMap &pathing_map, const QPointF &start, const QPointF &end,
+                        const PathingOptions &options);
+    void cached_path_found(std::vector<QPointF> path, PathStatus status);
 
 public slots:
-    void on_path_found(std::vector<QPointF> path);
+    void on_path_found(std::vector<QPointF> path, PathStatus status);
+
+private:
+    /// a find_path() request whose result has not been emitted yet
+    struct PendingRequest {
+        PathCache::Key key;
+        bool done;
+        std::vector<QPointF> path;
+        PathStatus status;
+    };
 
 private:
     Worker worker_;
     QThread worker_thread_;
+
+    PathCache cache_;
+    std::deque<PendingRequest> pending_requests_;
+    int cache_hits_ = 0;
+    int cache_misses_ = 0;
 };
 
 } // namespace cute
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PathGrid.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// The clearance of every cell of a PathGrid: the size of the biggest square of unfilled cells that has the cell
+/// as its top left corner (0 for filled cells).
+///
+/// An agent that covers `n` x `n` cells fits with its top left cell on a cell if the cell's clearance is at
+/// least `n`, so a search that only steps onto such cells (see PathingOptions::agent_size) finds paths that
+/// big agents can follow as they are, without checking the fit at every step.
+///
+/// It is built with a single pass from the bottom right corner: a cell's clearance is one more than the
+/// smallest clearance of its right, lower and lower right neighbors. After some cells of the grid changed,
+/// update() only computes again the clearance of the cells it changes for (up and left of the changed cells).
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// ClearanceMap clearance(grid);
+/// if (clearance.fits(x, y, 2)) {
+///     /// a 2x2 agent can stand at (x,y)
+/// }
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class ClearanceMap {
+public:
+    ClearanceMap(const PathGrid &grid);
+
+    void update(const PathGrid &grid, const std::vector<Node> &changed_cells);
+
+    int clearance(int x, int y) const;
+    bool fits(int x, int y, int agent_size) const { return clearance(x, y) >= agent_size; }
+
+    int num_cols() const { return num_cols_; }
+    int num_rows() const { return num_rows_; }
+
+private:
+    int compute(const PathGrid &grid, int x, int y) const;
+
+private:
+    int num_cols_;
+    int num_rows_;
+
+    /// per cell id (y * num_cols + x), capped at the biggest value that fits
+    std::vector<std::uint16_t> clearance_;
+};
+
+} // namespace cute
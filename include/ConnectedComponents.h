@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Node.h"
+#include "PathGrid.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// Labels the connected areas of unfilled cells of a PathGrid, so whether one cell can be reached from another
+/// is known without searching.
+///
+/// The labels are kept in a union-find structure over the cells (4-connected, which also covers every kind of
+/// 8 directional movement, since a diagonal step always passes an unfilled orthogonal neighbor). Building it
+/// joins every unfilled cell with its left and upper neighbor and then points every cell straight at its root,
+/// so right after building, reachable() is O(1).
+///
+/// Unfilling a cell only joins areas, which unfill() does in place. Filling a cell may split an area, which
+/// can't be undone in a union-find structure. But most filled cells (e.g. an entity stepping into an open room)
+/// can't split anything: if the unfilled neighbors of the cell stay connected around it, fill() just takes the
+/// cell out of its area. Only when they don't, the labels have to be built again.
+///
+/// Taking a cell out leaves its node in the forest (other nodes may hang under it), so a cell that is unfilled
+/// again gets a new node. The nodes of the cells taken out pile up until the next build.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// ConnectedComponents components(grid);
+/// if (components.reachable(from, to)) {
+///     std::vector<Node> path = grid.shortest_path(from, to);
+/// }
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class ConnectedComponents {
+public:
+    ConnectedComponents(const PathGrid &grid);
+
+    bool reachable(const Node &from, const Node &to) const;
+    void unfill(const PathGrid &grid, const Node &cell);
+    bool fill(const Node &cell);
+
+    int num_components() const { return num_components_; }
+
+private:
+    int find(int node) const;
+    void join(int node0, int node1);
+    int roots_around(const Node &cell, int roots[4]) const;
+    int roots_around_neighbors(const Node &cell, int roots[4]) const;
+    bool free_around_connected(const Node &cell) const;
+
+private:
+    int num_cols_;
+    int num_rows_;
+
+    /// per cell id (y * num_cols + x): the node of the cell in the union-find forest (-1 for filled cells).
+    /// A cell starts out with the node of the same id.
+    std::vector<int> cell_nodes_;
+
+    /// per node: the parent in the union-find forest (-1 for nodes not in it), and the size of the tree for roots
+    std::vector<int> parent_;
+    std::vector<int> size_;
+    int num_components_ = 0;
+};
+
+} // namespace cute
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ECFieldOfViewEmitter.h"
+#include "ECPathMover.h"
 #include "Entity.h"
 #include "EntityController.h"
 #include "Vendor.h"
@@ -9,7 +10,6 @@ class QTimer;
 
 namespace cute {
 
-class ECPathMover;
 class ECFieldOfViewEmitter;
 
 /// An entity controller that makes it so the controlled entity will chase certain other entities
@@ -30,6 +30,9 @@ class ECFieldOfViewEmitter;
 /// Some relavent terminlogy used in the context of ECChaser:
 /// - a "chasee" is any Entity that will be chased if it enters the field of view of the controlled entity.
 /// - the "target" or "target chasee" entity is the chasee that the controller is *currently* chasing.
+///
+/// When many chasers go after the same target, set_pathing_mode(ECPathMover::PathingMode::FlowField) makes them
+/// all follow one shared FlowField (see Map::flow_field()) instead of each searching its own path.
 
 class ECChaser : public EntityController {
     Q_OBJECT
@@ -49,6 +52,9 @@ public:
 
     void set_show_FOV(bool tf);
 
+    void set_pathing_mode(ECPathMover::PathingMode mode);
+    ECPathMover::PathingMode pathing_mode() const;
+
 signals:
     void entity_chase_started(Entity *chased_entity, double dist_to_chased_entity);
     void entity_chase_continued(Entity *chased_entity, double dist_to_chased_entity);
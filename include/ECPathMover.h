@@ -2,13 +2,14 @@
 
 #include "ECMover.h"
 #include "Entity.h"
+#include "IncrementalPathPlanner.h"
+#include "PathingOptions.h"
 #include "Vendor.h"
 
 class QTimer;
 
 namespace cute {
 
-class AsyncShortestPathFinder;
 class ECRotater;
 
 /// A Mover that moves the Entity in a path finding way. The entity will move
@@ -16,6 +17,14 @@ class ECRotater;
 /// continue to face its target position or if it should face the direction its
 /// heading into.
 ///
+/// Paths are found by the shared PathService. Only the newest move_entity() counts: a path that is still
+/// being searched for is dropped when move_entity() is called again, or when the mover stops or is destroyed.
+///
+/// Searches are not bounded by default and a target that can't be reached leaves the entity where it is. To make
+/// searches give up (PathingOptions::max_milliseconds, max_expansions) or make the entity go as close to an
+/// unreachable target as it can (PathingOptions::closest_reachable_fallback), set them in the pathing options.
+/// path_search_finished() tells how the search went.
+///
 /// Example usage:
 /// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
 /// PathMover* pm = new PathMover(entity);
@@ -32,6 +41,7 @@ class ECPathMover : public ECMover {
 
 public:
     ECPathMover(Entity *entity = nullptr);
+    ~ECPathMover();
 
     /// Sets how many pixels the entity should move every time he moves.
     /// This in effect controlls the "granularity" of the movement.
@@ -44,12 +54,40 @@ public:
     bool always_face_target_osition() { return always_face_target_position_; }
     void set_always_face_target_osition(bool tf) { always_face_target_position_ = tf; }
 
+    /// Sets how paths are searched for (e.g. to use Jump Point Search), applies to the next move_entity().
+    /// With PathingOptions::smooth_path the entity walks straight between corners, snapping to the grid
+    /// (and turning) only at those instead of at every cell. An entity whose PathingMap fills more than one cell
+    /// of the Map is searched for with an agent_size of (at least) the square around those cells, so the path
+    /// leaves room for all of them. The entity's PathingMap should start at the entity's position (the default).
+    void set_pathing_options(const PathingOptions &options) { pathing_options_ = options; }
+    const PathingOptions &pathing_options() const { return pathing_options_; }
+
+    /// How move_entity() finds its paths:
+    /// - Background: by the shared PathService, in another thread (the default).
+    /// - Hierarchical: right away by the Map's HierarchicalPathfinder (see Map::hierarchical_shortest_path()).
+    ///   Use it for long trips on big Maps. The budgets of the pathing options bound the search, options the
+    ///   HierarchicalPathfinder can't follow (8 directions, bigger agents) get a plain search.
+    /// - Incremental: right away by the mover's own IncrementalPathPlanner, which repairs the previous search
+    ///   (only the cells of the Map that changed since are looked at again). Use it for entities that keep
+    ///   re-issuing move_entity() while one end of the trip stays put (a fixed target on a busy Map, or a waiting
+    ///   entity whose target walks around), if both ends moved since the last call it searches anew. The budgets
+    ///   of the pathing options bound each call, a search that runs out of budget goes on at the next call.
+    /// - FlowField: right away from the Map's FlowField towards the target (see Map::flow_field()), which is
+    ///   shared with every other mover heading for the same cell. Use it when many entities chase one target.
+    /// clang-format off
+    enum class PathingMode { Background, Hierarchical, Incremental, FlowField };
+    /// clang-format on
+
+    void set_pathing_mode(PathingMode mode);
+    PathingMode pathing_mode() const { return pathing_mode_; }
+
 public slots:
-    void on_path_calculated(std::vector<QPointF> path);
+    void on_path_calculated(std::vector<QPointF> path, PathStatus status = PathStatus::Found);
     void on_move_step();
 
 signals:
     void moved(const QPointF &to_pos);
+    void path_search_finished(PathStatus status);
 
 protected:
     void move_entity_(const QPointF &to_pos) override;
@@ -58,6 +96,7 @@ protected:
 private:
     bool target_point_reached();
     void step_towards_target();
+    int footprint_size();
 
 private:
     /// controlled entity should continueously face last pos in path
@@ -67,8 +106,12 @@ private:
     /// how "granular" the movement should be
     int step_size_ = 5;
 
+    PathingOptions pathing_options_;
+    PathingMode pathing_mode_ = PathingMode::Background;
+    /// only kept in Incremental mode
+    std::unique_ptr<IncrementalPathPlanner> incremental_planner_;
+
     QTimer *move_timer_;
-    std::unique_ptr<AsyncShortestPathFinder> pf_;
     ECRotater *rotater_;
 
     /// moving helper attributes
@@ -79,7 +79,7 @@ public:
     QPointF origin() const { return origin_; }
     void set_origin(const QPointF &p) { origin_ = p; }
 
-    virtual void set_bounding_rect(const QRectF &rect) { bounding_rect_ = rect; }
+    virtual void set_bounding_rect(const QRectF &rect);
     virtual QRectF bounding_rect() const { return bounding_rect_; }
 
     QPolygonF bounding_polygon_in_map() const { return map_to_map(bounding_rect()); }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Node.h"
+#include "Vendor.h"
+
+namespace cute {
+
+class Entity;
+
+/// A uniform grid of square buckets over the plane, each holding the Entities whose bounds overlap it, so the
+/// Entities near a region are found without looking at all the others.
+///
+/// The bounds are given by the user (e.g. the bounding box of an Entity in its Map) and have to be updated
+/// whenever they change. entities() only returns candidates: every Entity whose bounds overlap a bucket the
+/// region overlaps, the exact test is up to the user. Buckets are only allocated where there are Entities, so
+/// the grid has no size and Entities may be anywhere.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// EntitySpatialHash hash;
+/// hash.update(entity, entity->bounding_polygon_in_map().boundingRect());
+/// for (Entity *candidate : hash.entities(QRectF(0, 0, 100, 100))) {
+///     /// candidate may be in the region
+/// }
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class EntitySpatialHash {
+public:
+    EntitySpatialHash(double bucket_size = 128);
+
+    void update(Entity *entity, const QRectF &bounds);
+    void remove(Entity *entity);
+    std::unordered_set<Entity *> entities(const QRectF &region) const;
+
+    int size() const { return bucket_ranges_.size(); }
+    double bucket_size() const { return bucket_size_; }
+
+private:
+    /// the buckets an Entity is in, both corners inclusive
+    struct BucketRange {
+        Node top_left;
+        Node bottom_right;
+    };
+
+    BucketRange bucket_range(const QRectF &bounds) const;
+    void add_to_buckets(Entity *entity, const BucketRange &range);
+    void remove_from_buckets(Entity *entity, const BucketRange &range);
+
+private:
+    double bucket_size_;
+    std::unordered_map<Node, std::vector<Entity *>> buckets_;
+    std::unordered_map<Entity *, BucketRange> bucket_ranges_;
+};
+
+} // namespace cute
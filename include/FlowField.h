@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Node.h"
+#include "PathGrid.h"
+#include "PathingOptions.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// A "Dijkstra map" towards one goal cell: for every cell of a PathGrid, the cost of the shortest path from it
+/// to the goal and the neighbor to step to next.
+///
+/// It is built by a single search that starts at the goal and spreads out over the whole grid, so any number of
+/// agents heading for the same goal can follow it (see path()) without searching themselves. The movement rules
+/// (4 or 8 directions, corner cutting) are taken from the PathingOptions, the algorithm and budgets are not used.
+///
+/// A FlowField keeps a copy of the grid it was built from (which shares the filling, see PathGrid), it does not
+/// follow later changes of the grid. Instead, a field for the changed grid can be made by repairing the old one:
+/// only the cells whose way to the goal went through a changed cell (and the cells next to the changed ones) are
+/// searched again, which is much cheaper than a new field when a few entities moved. Map::flow_field() keeps them
+/// cached per goal cell and repairs them for every new version of the Map.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// FlowField field(grid, player_cell);
+/// for (Node spider_cell : spider_cells) {
+///     std::vector<Node> path = field.path(spider_cell);
+/// }
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class FlowField {
+public:
+    FlowField(const PathGrid &grid, const Node &goal, const PathingOptions &options = PathingOptions());
+    FlowField(const FlowField &previous, const PathGrid &grid);
+
+    const Node &goal() const { return goal_; }
+    const PathingOptions &options() const { return options_; }
+
+    bool reachable(const Node &cell) const;
+    int cost(const Node &cell) const;
+    Node next(const Node &cell) const;
+
+    std::vector<Node> path(const Node &from) const;
+
+private:
+    /// (cost, cell id) with the lowest cost on top, entries whose cell got a lower cost later are skipped
+    typedef std::pair<int, int> OpenEntry;
+
+    void build();
+    void repair(const std::vector<Node> &changed_cells);
+    void spread(std::vector<OpenEntry> &open_nodes);
+    bool passable(int x, int y) const;
+    bool step_allowed(int from_cell, int to_cell) const;
+    bool diagonal_step_allowed(int x, int y, int dx, int dy) const;
+    int first_step(const Node &from) const;
+
+private:
+    PathGrid grid_;
+    Node goal_;
+    PathingOptions options_;
+
+    /// per cell id (y * num_cols + x): the cost to the goal (-1 if the goal can't be reached from the cell)
+    /// and the cell id to step to next (-1 for the goal itself and for unreachable cells)
+    std::vector<int> cost_;
+    std::vector<int> next_;
+};
+
+} // namespace cute
@@ -9,19 +9,23 @@ namespace cute {
 class Tree;
 
 /// A Graph is a set of Nodes and Edges.
+///
+/// Internally every Node gets a dense integer id (in the order the Nodes are added) and the Edges are kept
+/// in a CSR (compressed sparse row) adjacency layout: the outgoing (and incoming) Edges of a Node are one
+/// contiguous range. The layout is (re)built lazily the first time it is needed after the Graph changed,
+/// so adding many Nodes/Edges and then searching is cheap, while interleaving the two rebuilds it each time.
 class Graph {
 public:
     /// Please ensure that all of the Nodes of the Edges are actually Nodes in the set of Nodes.
     /// In other words, please make sure that the set of Nodes and Edges being passed in actually represent a graph.
-    /// This constructor does not do any checking.
-    Graph(const std::unordered_set<Node> &nodes, const std::unordered_set<Edge> &edges)
-            : nodes_(nodes), edges_(edges) {}
+    /// (Nodes that are only referenced by an Edge are added as well.)
+    Graph(const std::unordered_set<Node> &nodes, const std::unordered_set<Edge> &edges);
 
     /// constructs a Graph with no Nodes or Edges (empty Graph).
     Graph() {}
 
-    std::unordered_set<Node> nodes() const { return nodes_; }
-    std::unordered_set<Edge> edges() const { return edges_; }
+    std::unordered_set<Node> nodes() const;
+    std::unordered_set<Edge> edges() const;
     std::vector<Edge> outgoing_edges(const Node &from) const;
     std::vector<Edge> incoming_edges(const Node &to) const;
 
@@ -31,6 +35,9 @@ public:
     /// all ADJACENT nodes that can come to this node
     std::vector<Node> incoming_nodes(const Node &to) const;
 
+    int num_nodes() const { return nodes_.size(); }
+    int num_edges() const { return edges_.size(); }
+
     bool contains(const Node &node) const;
     bool contains(const Edge &edge) const;
     std::vector<Node> shortest_path(const Node &from, const Node &to) const;
@@ -40,44 +47,37 @@ public:
     void add_edge(const Node &from, const Node &to, int weight);
 
 private:
-    std::unordered_set<Node> nodes_;
-    std::unordered_set<Edge> edges_;
-
-    /// helper attributes for dijkstras
-    mutable std::unordered_set<Node> picked_nodes_;
-    mutable std::unordered_set<Node> unpicked_nodes_;
-    mutable std::unordered_set<Edge> picked_edges_;
-    mutable std::unordered_set<Edge> unpicked_edges_;
-    mutable std::unordered_map<Node, int> node_weight_;
-    mutable std::unordered_map<Node, Edge> updated_edge_;
-
-    /// helper functions for dijkstras
-    void pick(const Node &node) const;
-    void pick(const Edge &edge) const;
-    bool picked(const Node &node) const;
-    bool picked(const Edge &edge) const;
-    void set_weight(const Node &node, int weight) const;
-    int weight(const Node &node) const;
-    Edge edge(const Node &from, const Node &to) const;
-    void unpick_all() const;
-    void initialize_node_weights(const Node &source) const;
-    bool has_unpicked_node() const;
-    Node lightest_unpicked_node() const;
-    void pick_conneted_edge(const Node &node) const;
-    std::vector<Node> unpicked_neighbors(const Node &node) const;
-    void update_neighbor_weights(const Node &node) const;
-
-    /// helper attributes for A*
-    mutable std::unordered_set<Node> open_nodes_;
-    mutable std::unordered_set<Node> closed_nodes_;
-    mutable std::unordered_map<Node, Node> node_to_parent_;
-    mutable std::unordered_map<Node, int> node_to_F_cost_;
-    mutable std::unordered_map<Node, int> node_to_G_cost_;
-    mutable std::unordered_map<Node, int> node_to_H_cost_;
-
-    /// helper functions for A*
-    Node node_in_open_with_lowest_F_cost() const;
-    void calculate_costs(Node from, Node to) const;
+    struct EdgeEntry {
+        int from;
+        int to;
+        int weight;
+    };
+
+    int id(const Node &node) const;
+    static std::uint64_t edge_key(int from, int to);
+    Edge to_edge(const EdgeEntry &entry) const;
+
+    void build_adjacency() const;
+
+private:
+    /// id -> Node and Node -> id
+    std::vector<Node> nodes_;
+    std::unordered_map<Node, int> node_ids_;
+
+    /// Edges in the order they were added, edge_keys_ makes sure there is at most one Edge per (from,to) pair
+    std::vector<EdgeEntry> edges_;
+    std::unordered_set<std::uint64_t> edge_keys_;
+
+    /// CSR adjacency: the outgoing Edges of Node `i` are out_edges_[out_offsets_[i] .. out_offsets_[i + 1]]
+    /// (indices into edges_), same for the incoming Edges.
+    mutable bool adjacency_dirty_ = true;
+    mutable std::vector<int> out_offsets_;
+    mutable std::vector<int> out_edges_;
+    mutable std::vector<int> in_offsets_;
+    mutable std::vector<int> in_edges_;
+
+    /// the smallest (Edge weight / Manhattan length of the Edge), scales the A* heuristic so it never overestimates
+    mutable double heuristic_scale_ = 1;
 };
 
 } // namespace cute
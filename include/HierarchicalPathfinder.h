@@ -0,0 +1,128 @@
+#pragma once
+
+#include "Node.h"
+#include "PathGrid.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// Finds (4-connected) paths on large PathGrids by searching an abstract graph first (HPA*).
+///
+/// The grid is divided into square clusters. Wherever two neighboring clusters touch through unfilled cells,
+/// "entrance" cells are placed on both sides of the border, and the distances between the entrances of each
+/// cluster are precomputed (by a search that stays inside the cluster). A query connects its start and end
+/// to the entrances of their clusters, runs A* over the entrances only, and then fills in the cells between
+/// consecutive entrances with small searches inside one cluster.
+///
+/// The HierarchicalPathfinder keeps its own copy of the grid. update() compares a new grid with it and only
+/// repairs the clusters that changed (and their neighbors, whose entrances may have moved), so keeping it
+/// up to date as Entities move around is cheap.
+///
+/// The paths found are not always the shortest possible (they must go through entrances), but usually
+/// only a few percent longer. Only 4 directional movement for agents of one cell is supported, the budgets,
+/// closest_reachable_fallback and smooth_path of the PathingOptions are used.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// HierarchicalPathfinder pathfinder;
+/// pathfinder.update(grid);
+/// std::vector<Node> path = pathfinder.shortest_path(Node(0,0), Node(900,700));
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class HierarchicalPathfinder {
+public:
+    HierarchicalPathfinder(int cluster_size = 16);
+
+    void update(const PathGrid &grid);
+
+    std::vector<Node> shortest_path(const Node &from, const Node &to, const PathingOptions &options = PathingOptions(),
+                                    PathStatus *status = nullptr);
+
+    int cluster_size() const { return cluster_size_; }
+    int num_clusters() const { return clusters_.size(); }
+    int num_entrances() const;
+
+    /// number of clusters whose entrances were recomputed by the last update()
+    int num_repaired_clusters() const { return num_repaired_clusters_; }
+
+private:
+    /// a pair of neighboring unfilled cells on the two sides of a cluster border
+    struct Transition {
+        int inside;  /// cell in the west/north cluster
+        int outside; /// cell in the east/south cluster
+    };
+
+    struct Cluster {
+        /// entrance cells of the cluster (sorted)
+        std::vector<int> entrances;
+
+        /// distances[i * entrances.size() + j] is the distance from entrance i to entrance j, -1 if unreachable
+        std::vector<int> distances;
+
+        /// crossings[i] are the cells of neighboring clusters that entrance i steps to over a border
+        std::vector<std::vector<int>> crossings;
+    };
+
+    struct OpenEntry {
+        int f_cost;
+        int h_cost;
+        int g_cost;
+        int cell;
+    };
+
+    struct OpenEntryCompare {
+        bool operator()(const OpenEntry &lhs, const OpenEntry &rhs) const {
+            if (lhs.f_cost != rhs.f_cost) {
+                return lhs.f_cost > rhs.f_cost;
+            }
+            return lhs.h_cost > rhs.h_cost;
+        }
+    };
+
+    struct SearchState {
+        int g_cost;
+        int parent;
+        bool closed;
+    };
+
+    int cluster_of(int cell) const;
+    void cluster_bounds(int cluster, int &x0, int &y0, int &x1, int &y1) const;
+    int entrance_index(int cluster, int cell) const;
+    std::vector<int> endpoint_cells(int cell) const;
+
+    void rebuild();
+    void repair(const std::vector<bool> &dirty);
+    void build_borders(int cluster);
+    void build_border(int inside_x, int inside_y, int step_x, int step_y, int along_x, int along_y, int length,
+                      std::vector<Transition> &transitions);
+    void build_cluster(int cluster);
+
+    void local_search(int cluster, int origin, int target, bool stop_at_target = false);
+    int local_distance(int cluster, int cell) const;
+    void append_local_path(int cluster, int from, int to, std::vector<Node> &path);
+
+private:
+    int cluster_size_;
+
+    /// the grid as of the last update()
+    PathGrid grid_;
+    int num_cols_ = 0;
+    int num_rows_ = 0;
+
+    int clusters_x_ = 0;
+    int clusters_y_ = 0;
+    std::vector<Cluster> clusters_;
+
+    /// transitions over the east (south) border of each cluster
+    std::vector<std::vector<Transition>> east_transitions_;
+    std::vector<std::vector<Transition>> south_transitions_;
+
+    int num_repaired_clusters_ = 0;
+
+    /// scratch space of local_search(), indexed by the position of a cell within the cluster
+    std::vector<int> local_distance_;
+    std::vector<int> local_parent_;
+    std::vector<int> local_queue_;
+};
+
+} // namespace cute
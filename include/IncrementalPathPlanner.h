@@ -0,0 +1,95 @@
+#pragma once
+
+#include "IndexedMinHeap.h"
+#include "Node.h"
+#include "PathGrid.h"
+#include "PathingOptions.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// Keeps finding paths between two cells as one of them moves and the grid changes, repairing its previous
+/// search instead of starting over (D* Lite).
+///
+/// The search is rooted at one end of the path and runs towards the other end, so the costs it has found stay
+/// valid when that other end moves. It starts out rooted at the target, and whenever the end it is rooted at
+/// moves, the new search is rooted at the end that stayed put: a mover heading for a fixed spot keeps its search
+/// rooted at the spot, a mover that stands still while its target walks around (e.g. a turret, or a chaser
+/// waiting for its path) has it rooted at itself. When shortest_path() is called with a changed grid, only the
+/// cells whose filling changed (see PathGrid::changed_cells()) and their neighbors are updated, and the search
+/// continues from there. So replanning after a few cells changed (e.g. another entity took a step) costs time
+/// proportional to the change, not to the size of the grid.
+///
+/// D* Lite can only follow one moving end: if both ends moved since the last call (or the grid has a different
+/// size), a new search is started. The search state takes a few ints per cell of the grid, so keep one planner
+/// per mover, not one per path.
+///
+/// The movement rules (4 or 8 directions, corner cutting) and the budgets (max_expansions, max_milliseconds) are
+/// taken from the PathingOptions, the algorithm, the fallback and the smoothing are not used. The budgets bound
+/// each call: when one runs out, no path is returned (PathStatus::BudgetExceeded) and the search is kept as it is,
+/// so the next call picks it up where it stopped (unless that call has to start a new search). Keep a budget on
+/// planners whose target may be unreachable, or every new search floods the whole grid before giving up.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// IncrementalPathPlanner planner;
+/// std::vector<Node> path = planner.shortest_path(grid, entity_cell, target_cell);
+/// ...  /// the entity moves, some cells of the grid change
+/// path = planner.shortest_path(grid, entity_cell, target_cell);
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class IncrementalPathPlanner {
+public:
+    IncrementalPathPlanner(const PathingOptions &options = PathingOptions());
+
+    std::vector<Node> shortest_path(const PathGrid &grid, const Node &from, const Node &to,
+                                    PathStatus *status = nullptr);
+    void reset();
+
+    const PathingOptions &options() const { return options_; }
+
+    /// number of cells expanded / changed cells found by the last shortest_path()
+    int num_expanded() const { return num_expanded_; }
+    int num_changed_cells() const { return num_changed_cells_; }
+
+private:
+    typedef std::pair<int, int> Key;
+
+    void begin_search(const PathGrid &grid, int start_cell, int root_cell);
+    bool compute_shortest_path();
+    void update_cell(int cell);
+    Key key(int cell) const;
+
+    bool passable(int x, int y) const;
+    int step_cost(int from_cell, int direction) const;
+    int distance(int cell0, int cell1) const;
+    std::vector<Node> build_path() const;
+
+private:
+    PathingOptions options_;
+
+    /// the grid searched in (as of the last shortest_path()), the cell the search is rooted at (the D* Lite
+    /// "goal") and the other end of the path (the D* Lite "start"). If rooted_at_from_, the search is rooted at
+    /// the `from` cell of shortest_path() and the path is reversed, else at the `to` cell.
+    PathGrid grid_;
+    bool searching_ = false;
+    bool rooted_at_from_ = false;
+    int num_cols_ = 0;
+    int num_rows_ = 0;
+    int goal_cell_ = -1;
+    int start_cell_ = -1;
+
+    /// per cell id (y * num_cols + x): the cost to the root as last expanded (g), and as its neighbors say it
+    /// should be (rhs). Cells where the two differ are in the open list.
+    std::vector<int> g_;
+    std::vector<int> rhs_;
+    IndexedMinHeap<Key> open_cells_;
+
+    /// added to the keys whenever the start moves, instead of reordering the open list
+    int key_modifier_ = 0;
+
+    int num_expanded_ = 0;
+    int num_changed_cells_ = 0;
+};
+
+} // namespace cute
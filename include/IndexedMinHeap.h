@@ -0,0 +1,170 @@
+#pragma once
+
+#include "Vendor.h"
+
+namespace cute {
+
+/// A binary min-heap of integer ids (0 <= id < num_ids) that knows where each id sits in the heap.
+///
+/// Because the position of every id is tracked, the priority of an id that is already in the heap
+/// can be lowered in O(log(n)) ("decrease-key"), which is what Dijkstra and A* need. Incremental searches
+/// (D* Lite) also need to raise priorities and take ids out of the middle of the heap, see update() and remove().
+/// Ids with equal priority come out in an arbitrary order.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// IndexedMinHeap<int> heap(num_nodes);
+/// heap.push_or_decrease(source, 0);
+/// while (!heap.empty()) {
+///     int weight = heap.top_priority();
+///     int node = heap.pop();
+///     ...
+/// }
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+template <typename Priority>
+class IndexedMinHeap {
+public:
+    IndexedMinHeap(int num_ids = 0) { reset(num_ids); }
+
+    void reset(int num_ids);
+
+    bool empty() const { return heap_.empty(); }
+    int size() const { return heap_.size(); }
+    bool contains(int id) const { return positions_[id] != -1; }
+
+    int top() const { return heap_.front(); }
+    const Priority &top_priority() const { return priorities_[heap_.front()]; }
+    const Priority &priority(int id) const { return priorities_[id]; }
+
+    int pop();
+    bool push_or_decrease(int id, const Priority &priority);
+    void update(int id, const Priority &priority);
+    void remove(int id);
+
+private:
+    void sift_up(int position);
+    void sift_down(int position);
+    void place(int id, int position);
+
+private:
+    std::vector<int> heap_;
+    std::vector<int> positions_;
+    std::vector<Priority> priorities_;
+};
+
+/// Empties the heap and makes room for ids in [0, num_ids).
+template <typename Priority>
+void IndexedMinHeap<Priority>::reset(int num_ids) {
+    heap_.clear();
+    positions_.assign(num_ids, -1);
+    priorities_.resize(num_ids);
+}
+
+/// Removes the id with the lowest priority and returns it.
+template <typename Priority>
+int IndexedMinHeap<Priority>::pop() {
+    assert(!empty());
+
+    int id = heap_.front();
+    int last = heap_.back();
+    heap_.pop_back();
+    positions_[id] = -1;
+    if (!heap_.empty()) {
+        place(last, 0);
+        sift_down(0);
+    }
+    return id;
+}
+
+/// Adds the id with the specified priority, or lowers its priority if it is already in the heap.
+/// Returns false (and does nothing) if the id is already in the heap with a priority that is not higher.
+template <typename Priority>
+bool IndexedMinHeap<Priority>::push_or_decrease(int id, const Priority &priority) {
+    if (contains(id)) {
+        if (!(priority < priorities_[id])) {
+            return false;
+        }
+        priorities_[id] = priority;
+        sift_up(positions_[id]);
+        return true;
+    }
+
+    priorities_[id] = priority;
+    heap_.push_back(id);
+    positions_[id] = heap_.size() - 1;
+    sift_up(heap_.size() - 1);
+    return true;
+}
+
+/// Adds the id with the specified priority, or changes its priority (up or down) if it is already in the heap.
+template <typename Priority>
+void IndexedMinHeap<Priority>::update(int id, const Priority &priority) {
+    if (!contains(id)) {
+        push_or_decrease(id, priority);
+        return;
+    }
+    priorities_[id] = priority;
+    sift_up(positions_[id]);
+    sift_down(positions_[id]);
+}
+
+/// Takes the id out of the heap (if it is in the heap).
+template <typename Priority>
+void IndexedMinHeap<Priority>::remove(int id) {
+    if (!contains(id)) {
+        return;
+    }
+    int position = positions_[id];
+    int last = heap_.back();
+    heap_.pop_back();
+    positions_[id] = -1;
+    if (position < static_cast<int>(heap_.size())) {
+        place(last, position);
+        sift_up(position);
+        sift_down(positions_[last]);
+    }
+}
+
+template <typename Priority>
+void IndexedMinHeap<Priority>::sift_up(int position) {
+    int id = heap_[position];
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!(priorities_[id] < priorities_[heap_[parent]])) {
+            break;
+        }
+        place(heap_[parent], position);
+        position = parent;
+    }
+    place(id, position);
+}
+
+template <typename Priority>
+void IndexedMinHeap<Priority>::sift_down(int position) {
+    int id = heap_[position];
+    int n = heap_.size();
+    while (true) {
+        int child = position * 2 + 1;
+        if (child >= n) {
+            break;
+        }
+        if (child + 1 < n && priorities_[heap_[child + 1]] < priorities_[heap_[child]]) {
+            child++;
+        }
+        if (!(priorities_[heap_[child]] < priorities_[id])) {
+            break;
+        }
+        place(heap_[child], position);
+        position = child;
+    }
+    place(id, position);
+}
+
+template <typename Priority>
+void IndexedMinHeap<Priority>::place(int id, int position) {
+    heap_[position] = id;
+    positions_[id] = position;
+}
+
+} // namespace cute
@@ -1,6 +1,10 @@
 #pragma once
 
+#include "EntitySpatialHash.h"
+#include "FlowField.h"
 #include "Game.h"
+#include "HierarchicalPathfinder.h"
+#include "PathingDebugOverlay.h"
 #include "PathingMap.h"
 #include "PositionalSound.h"
 #include "TerrainLayer.h"
@@ -21,7 +25,8 @@ class WeatherEffect;
 ///
 /// A Map has a PathingMap which keeps track of which cells are free and which are blocked.
 /// Each Entity can also contain its own PathingMap therefore the Map is notified every time
-/// an Entity is added/moved so that the Map's PathingMap can be updated accordingly.
+/// an Entity is added/moved so that the Map's PathingMap can be updated accordingly. The updates are batched,
+/// see update_pathing_map().
 ///
 /// A Map can be visualized by a Game. If the Map is currently being visualized by a game,
 /// the Map::game() function will return that Game, otherwise it will return nullptr.
@@ -32,6 +37,9 @@ class Map : public QObject {
     /// game needs to be able to set game_ ptr of Map (in Game::set_current_map())
     friend class Game;
 
+    /// entities need to tell the Map when their bounds change (see update_entity_bounds())
+    friend class Entity;
+
 public:
     Map(PathingMap *pathing_map);
 
@@ -45,10 +53,21 @@ public:
 
     QPointF get_mouse_position();
 
-    PathingMap &pathing_map() { return *overall_pathing_map_; }
+    PathingMap &pathing_map();
+    std::shared_ptr<const PathingMap> pathing_map_snapshot(const PathingMap *ignoring = nullptr,
+                                                           bool with_clearance_map = false);
     void add_pathing_map(PathingMap &pm, const QPointF &at_pos);
     void remove_pathing_map(PathingMap &pm);
     void update_pathing_map();
+    void flush_pathing_updates();
+    bool free(const QPointF &point, const PathingMap *ignoring = nullptr);
+    bool can_fit(const PathingMap &pm, const QPointF &at_pos, const PathingMap *ignoring = nullptr);
+
+    std::vector<QPointF> hierarchical_shortest_path(const QPointF &from_pos, const QPointF &to_pos,
+                                                    const PathingOptions &options = PathingOptions(),
+                                                    PathStatus *status = nullptr);
+    std::shared_ptr<const FlowField> flow_field(const QPointF &goal_pos,
+                                                const PathingOptions &options = PathingOptions());
 
     int width() const;
     int height() const;
@@ -73,13 +92,9 @@ public:
     /// If the map isn't currently being visualized, returns nullptr.
     Game *game() { return game_; }
 
-    /// for testing
-    void remove_and_clear_debugging_polygons(std::vector<QGraphicsPolygonItem *> &polygons);
-    void draw_pathing_map();
-    QGraphicsPolygonItem *draw_filled_cell(Node &cell);
-    QGraphicsPolygonItem *draw_empty_cell(Node &cell);
-    void draw_entity_pathing_map_bounds();
-    void draw_entity_bounding_boxes();
+    /// for debugging
+    void set_pathing_debug_overlay_visible(bool visible);
+    bool pathing_debug_overlay_visible() const { return pathing_debug_overlay_ != nullptr; }
 
     /// getting all entities at a certain point/region/colliding w other entities
     std::unordered_set<Entity *> entities(const QRectF &rect);
@@ -122,6 +137,11 @@ public slots:
 
 private:
     void set_game(Game *game);
+    void change_occupancy(const std::vector<Node> &footprint, int delta);
+    void update_entity_bounds(Entity *entity);
+    bool cells_free(const std::vector<Node> &cells, const PathingMap *ignoring);
+    std::unordered_map<Node, int> ignored_occupancy(const PathingMap *ignoring);
+    void update_pathing_debug_overlay_entity_boxes();
 
 private:
     int num_cells_wide_;
@@ -133,14 +153,56 @@ private:
     /// Map's own pathing map, this can be arbitrarly filled by client
     PathingMap *own_pathing_map_;
 
-    /// additional pathing maps (and their location)
-    std::unordered_map<PathingMap *, QPointF> additional_pathing_map_;
+    /// additional pathing maps, with the cells of the Map they fill (their footprint) and the version of the
+    /// additional pathing map the footprint was taken from
+    struct AddedPathingMap {
+        QPointF pos;
+        std::uint64_t version;
+        std::vector<Node> footprint;
+    };
+    std::unordered_map<const PathingMap *, AddedPathingMap> additional_pathing_maps_;
+
+    /// per cell id (y * num_cells_wide + x): how many footprints of additional pathing maps cover the cell
+    std::vector<int> occupancy_;
+
+    /// cells whose occupancy changed since the last flush_pathing_updates() (in the order they changed,
+    /// possibly more than once), and the smallest rect (in cells) around them
+    std::vector<Node> dirty_cells_;
+    QRect dirty_rect_;
+
+    /// true if update_pathing_map() was called since the last flush_pathing_updates()
+    bool pathing_update_pending_ = false;
+
+    /// the version of own_pathing_map_ that overall_pathing_map_ was last merged from
+    std::uint64_t merged_own_version_ = 0;
 
-    /// the "merge" of "own_pathing_map_" and all "additional_pathing_map_"
+    /// the "merge" of "own_pathing_map_" and all "additional_pathing_maps_" (a cell is filled if it is filled in
+    /// own_pathing_map_ or its occupancy is above 0)
     /// overall_pathing_map_ has the same size as own_pathing_map_
     PathingMap *overall_pathing_map_;
 
+    /// an unchangeable copy of overall_pathing_map_, shared by everyone searching paths in the background
+    std::shared_ptr<const PathingMap> pathing_map_snapshot_;
+
+    /// true once a snapshot with a ClearanceMap was asked for, overall_pathing_map_ then keeps one up to date
+    bool clearance_map_wanted_ = false;
+
+    /// built on first use, brought up to date with overall_pathing_map_ lazily (only the changed clusters)
+    std::unique_ptr<HierarchicalPathfinder> hierarchical_pathfinder_;
+    bool hierarchical_pathfinder_dirty_ = true;
+
+    /// FlowFields by goal cell, each one for the version of pathing_map() it was built from
+    struct CachedFlowField {
+        std::uint64_t version;
+        std::shared_ptr<const FlowField> flow_field;
+    };
+    std::unordered_map<Node, CachedFlowField> flow_fields_;
+    static const int max_cached_flow_fields = 16;
+
     std::unordered_set<Entity *> entities_;
+
+    /// entities_ by their bounding boxes in the Map, so entities() only looks at the ones near the region
+    EntitySpatialHash entity_hash_;
     std::vector<TerrainLayer *> terrain_layers_;
     std::set<WeatherEffect *> weather_effects_;
 
@@ -155,10 +217,8 @@ private:
     /// the Map itself is basicly a wrapper of QGraphicsScene
     QGraphicsScene *scene_;
 
-    /// for debugging
-    std::vector<QGraphicsPolygonItem *> debugging_pathing_map_rects_;
-    std::vector<QGraphicsPolygonItem *> debugging_entity_pathing_map_boxes_;
-    std::vector<QGraphicsPolygonItem *> debugging_entity_bounding_boxes_;
+    /// for debugging, null unless the overlay is visible
+    PathingDebugOverlay *pathing_debug_overlay_ = nullptr;
 };
 
 } // namespace cute
@@ -29,9 +29,12 @@ bool operator!=(const cute::Node &lhs, const cute::Node &rhs);
 } // namespace cute
 
 // make node hashable
+// (x and y are packed into one 64 bit value, adding their hashes made every anti-diagonal collide)
 namespace std {
 template <>
 struct hash<cute::Node> {
-    size_t operator()(const cute::Node &node) const { return hash<int>()(node.x()) + hash<int>()(node.y()); }
+    size_t operator()(const cute::Node &node) const {
+        return hash<std::uint64_t>()((std::uint64_t(std::uint32_t(node.x())) << 32) | std::uint32_t(node.y()));
+    }
 };
 } // namespace std
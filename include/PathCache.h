@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Node.h"
+#include "PathingOptions.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// A least recently used cache of paths (and how their search ended) found in a PathingMap.
+///
+/// A path is keyed by its start cell, its end cell, the version of the PathingMap it was found in
+/// (see PathingMap::version()) and the PathingOptions used. Since a PathingMap moves to a new version
+/// whenever it changes, cached paths never have to be invalidated, stale ones just stop being asked for
+/// and eventually fall out of the cache.
+
+class PathCache {
+public:
+    struct Key {
+        Node from;
+        Node to;
+        std::uint64_t version;
+        PathingOptions options;
+    };
+
+    PathCache(int capacity = 32);
+
+    bool find(const Key &key, std::vector<QPointF> &path, PathStatus &status);
+    void insert(const Key &key, const std::vector<QPointF> &path, PathStatus status);
+    void clear();
+
+    int size() const { return entries_.size(); }
+    int capacity() const { return capacity_; }
+    void set_capacity(int capacity);
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct KeyEqual {
+        bool operator()(const Key &lhs, const Key &rhs) const {
+            return lhs.from == rhs.from && lhs.to == rhs.to && lhs.version == rhs.version &&
+                   lhs.options == rhs.options;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<QPointF> path;
+        PathStatus status;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    void evict();
+
+private:
+    int capacity_;
+
+    /// most recently used first
+    EntryList entries_;
+    std::unordered_map<Key, EntryList::iterator, KeyHash, KeyEqual> index_;
+};
+
+} // namespace cute
@@ -1,17 +1,31 @@
 #pragma once
 
-#include "Graph.h"
 #include "Node.h"
+#include "PathingOptions.h"
 #include "Vendor.h"
 
 namespace cute {
 
+class ClearanceMap;
+
 /// Represents a grid of Nodes, each of which can either be filled or unfilled.
 /// The (x,y) value of the top left node is (0,0). The (x,y) value of the bottom right node is (width,height).
+///
+/// The filling is stored as a row-major bitset (one bit per Node, 64 Nodes per word, every row starts on a
+/// new word), so filling/unfilling regions and merging PathGrids are done a whole word at a time.
+///
+/// The bits are copy-on-write: copying a PathGrid only shares the bits with the original, they are copied
+/// the first time either PathGrid is changed. So handing copies to other threads is cheap, and a PathGrid
+/// copy that is never changed can be read from any number of threads.
+///
+/// Worker threads must only ever get snapshots: copies made on the thread that owns the PathGrid, which the
+/// workers then read (or copy again) but never change. The owner can then trust mutable_bits(): when it sees
+/// that nobody else shares the bits, no other thread holds a reference it could still copy them from.
 
 class PathGrid {
 public:
-    PathGrid() : num_cols_(0), num_rows_(0) {}
+    PathGrid()
+            : bits_(std::make_shared<std::vector<std::uint64_t>>()), num_cols_(0), num_rows_(0), words_per_row_(0) {}
     PathGrid(int num_cols, int num_rows);
 
     /// make compiler generate default copy ctor
@@ -21,8 +35,14 @@ public:
     bool filled(int x, int y) const;
 
     std::vector<Node> unfilled_neighbors(const Node &node) const;
+    std::vector<Node> unfilled_neighbors(const Node &node, const PathingOptions &options) const;
 
-    std::vector<Node> shortest_path(const Node &from, const Node &to) const;
+    std::vector<Node> shortest_path(const Node &from, const Node &to, const PathingOptions &options = PathingOptions(),
+                                    PathStatus *status = nullptr, const ClearanceMap *clearance = nullptr) const;
+    bool line_of_sight(const Node &from, const Node &to, int agent_size = 1,
+                       const ClearanceMap *clearance = nullptr) const;
+    std::vector<Node> smooth_path(const std::vector<Node> &path, int agent_size = 1,
+                                  const ClearanceMap *clearance = nullptr) const;
 
     std::vector<Node> nodes(const Node &top_left, const Node &bottom_right) const;
     std::vector<Node> nodes() const;
@@ -35,23 +55,37 @@ public:
     int num_cols() const { return num_cols_; }
     int num_rows() const { return num_rows_; }
 
+    std::uint64_t row_bits(int y, int x) const;
+    std::vector<Node> changed_cells(const PathGrid &other) const;
+
     void fill(const Node &node);
     void fill(int x, int y);
+    void fill(const Node &top_left, const Node &bottom_right);
     void fill();
     void unfill(const Node &node);
     void unfill(int x, int y);
+    void unfill(const Node &top_left, const Node &bottom_right);
     void unfill();
     void set_filling(const std::vector<std::vector<int>> &vec);
     void set_filling(const PathGrid &path_grid, const Node &pos);
     void add_path_grid(const PathGrid &path_grid, const Node &pos);
 
 private:
-    std::vector<std::vector<Node>> nodes_;
-    std::unordered_map<Node, bool> filled_;
+    /// bit x of a row lives in word (x / 64), at bit (x % 64) of that word
+    std::shared_ptr<std::vector<std::uint64_t>> bits_;
     int num_cols_;
     int num_rows_;
+    int words_per_row_;
 
-    Graph to_graph(const Node &start, const Node &end) const;
+    std::vector<std::uint64_t> &mutable_bits();
+    std::uint64_t column_mask(int word_index) const;
+    void set_region(int x0, int y0, int x1, int y1, bool filled);
+
+    friend bool operator==(const PathGrid &lhs, const PathGrid &rhs);
 };
 
+/// two PathGrids are equal if they have the same size and the same cells filled
+bool operator==(const PathGrid &lhs, const PathGrid &rhs);
+bool operator!=(const PathGrid &lhs, const PathGrid &rhs);
+
 } // namespace cute
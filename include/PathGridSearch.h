@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ClearanceMap.h"
+#include "Node.h"
+#include "PathGrid.h"
+#include "PathingOptions.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// Runs A* (or Jump Point Search) directly on the cells of a PathGrid, without building a Graph first.
+///
+/// Neighbors are generated on the fly from the PathGrid. The per-cell bookkeeping (G cost, parent, closed)
+/// lives in flat arrays indexed by cell id (y * num_cols + x). Instead of clearing these arrays, every search
+/// bumps a generation counter and a cell's entries only count if they were stamped with the current generation.
+/// So when a PathGridSearch is reused for many queries, each query only pays for the cells it actually touches.
+///
+/// A search can be bounded with PathingOptions::max_expansions and max_milliseconds. status() tells how the last
+/// search ended (see PathStatus).
+///
+/// A PathGridSearch is not thread safe, use one per thread.
+
+class PathGridSearch {
+public:
+    PathGridSearch() {}
+
+    std::vector<Node> shortest_path(const PathGrid &grid, const Node &from, const Node &to,
+                                    const PathingOptions &options = PathingOptions(),
+                                    const ClearanceMap *clearance = nullptr);
+
+    /// number of cells taken off the open list by the last search
+    int num_expanded() const { return num_expanded_; }
+
+    PathStatus status() const { return status_; }
+
+private:
+    struct OpenEntry {
+        int f_cost;
+        int h_cost;
+        int g_cost;
+        int cell;
+    };
+
+    /// orders the open list so that the top is the lowest F cost (lowest H cost if multiple equal F costs)
+    struct OpenEntryCompare {
+        bool operator()(const OpenEntry &lhs, const OpenEntry &rhs) const {
+            if (lhs.f_cost != rhs.f_cost) {
+                return lhs.f_cost > rhs.f_cost;
+            }
+            return lhs.h_cost > rhs.h_cost;
+        }
+    };
+
+    void begin_search(const PathGrid &grid, const Node &to, const PathingOptions &options);
+    bool visited(int cell) const { return visited_generation_[cell] == generation_; }
+    bool closed(int cell) const { return closed_generation_[cell] == generation_; }
+    bool passable(int x, int y) const;
+    std::uint64_t passable_bits(int y, int x) const;
+    bool diagonal_step_allowed(int x, int y, int dx, int dy) const;
+    int distance(int x0, int y0, int x1, int y1) const;
+    int h_cost(int x, int y) const { return distance(x, y, to_x_, to_y_); }
+
+    void push_open(const OpenEntry &entry);
+    OpenEntry pop_open();
+    void relax(int cell, int from_cell, int g_cost);
+    bool expand(int cell);
+
+    bool a_star();
+    bool jump_point_search();
+    int jump_horizontal(int x, int y, int dx) const;
+    int jump_vertical(int x, int y, int dy) const;
+
+    bool diagonal_jump_point_search();
+    int jump_vertical_straight(int x, int y, int dy) const;
+    int jump_diagonal(int x, int y, int dx, int dy) const;
+
+    std::vector<Node> build_path(int to_cell) const;
+
+private:
+    std::vector<int> g_cost_;
+    std::vector<int> parent_;
+    std::vector<std::uint32_t> visited_generation_;
+    std::vector<std::uint32_t> closed_generation_;
+    std::uint32_t generation_ = 0;
+
+    /// binary heap (see OpenEntryCompare), kept as a member so its storage is reused between searches
+    std::vector<OpenEntry> open_nodes_;
+
+    /// the query currently being searched
+    const PathGrid *grid_ = nullptr;
+    const ClearanceMap *clearance_ = nullptr;
+    PathingOptions options_;
+    int num_cols_ = 0;
+    int num_rows_ = 0;
+    int to_x_ = 0;
+    int to_y_ = 0;
+    int to_cell_ = 0;
+
+    int num_expanded_ = 0;
+    PathStatus status_ = PathStatus::Unreachable;
+
+    /// the visited cell with the lowest H cost so far (lowest G cost among equal H costs), for the fallback path
+    int closest_cell_ = -1;
+    int closest_h_cost_ = 0;
+
+    bool budget_exceeded_ = false;
+    std::chrono::steady_clock::time_point deadline_;
+};
+
+} // namespace cute
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "PathCache.h"
+#include "PathingMap.h"
+#include "PathingOptions.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// Finds paths for many requesters (e.g. all the ECPathMovers of a game) on a shared pool of worker threads.
+///
+/// Each request is made on behalf of a requester. A requester only ever gets the result of its newest request:
+/// a request that is still waiting in the queue is replaced by a newer request of the same requester, and
+/// results of older requests that were already being worked on are dropped. cancel() drops everything
+/// of a requester (call it when the requester stops caring or is destroyed).
+///
+/// Results are delivered in batches on the thread the PathService lives in (the main thread for instance()),
+/// by calling the callback passed with the request (along with how the search ended, see PathStatus).
+/// Found paths are also kept in a PathCache, so repeating a
+/// request in an unchanged PathingMap does not go to the workers at all, and neither does a request whose
+/// target can't be reached (see PathingMap::reachable()).
+///
+/// The PathingMap searched in is shared with the request (see Map::pathing_map_snapshot()), not copied.
+///
+/// The request, cancel and cache functions must be called from the thread the PathService lives in.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// PathService::instance()->request_path(this, map->pathing_map_snapshot(), from, to, PathingOptions(),
+///                                       [this](std::vector<QPointF> path, PathStatus status) { follow(path); });
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class PathService : public QObject {
+    Q_OBJECT
+
+public:
+    typedef std::function<void(std::vector<QPointF>, PathStatus)> Callback;
+
+    static PathService *instance();
+    static PathService *existing();
+
+    PathService(int num_workers = QThread::idealThreadCount());
+    ~PathService();
+
+    void request_path(const void *requester, std::shared_ptr<const PathingMap> pathing_map, const QPointF &start,
+                      const QPointF &end, const PathingOptions &options, Callback callback);
+    void request_path(const void *requester, const PathingMap &pathing_map, const QPointF &start, const QPointF &end,
+                      const PathingOptions &options, Callback callback);
+    void cancel(const void *requester);
+    void shutdown();
+
+    int num_workers() const { return workers_.size(); }
+
+    /// number of requests that were (not) answered from the cache
+    int cache_hits() const { return cache_hits_; }
+    int cache_misses() const { return cache_misses_; }
+
+    /// number of requests answered right away with PathStatus::Unreachable, without a search
+    int rejected_requests() const { return rejected_requests_; }
+
+    void set_cache_capacity(int capacity) { cache_.set_capacity(capacity); }
+    int cache_capacity() const { return cache_.capacity(); }
+
+private slots:
+    void deliver_results();
+
+private:
+    struct Job {
+        const void *requester;
+        std::uint64_t ticket;
+        PathCache::Key key;
+        std::shared_ptr<const PathingMap> pathing_map;
+        QPointF start;
+        QPointF end;
+        PathingOptions options;
+        Callback callback;
+    };
+
+    struct Result {
+        const void *requester;
+        std::uint64_t ticket;
+        PathCache::Key key;
+        std::vector<QPointF> path;
+        PathStatus status;
+        Callback callback;
+        bool from_cache;
+    };
+
+    void work();
+    void add_result(Result result);
+
+private:
+    std::vector<std::thread> workers_;
+
+    /// everything below is guarded by mutex_ (except the cache and its counters, only used by the owning thread)
+    std::mutex mutex_;
+    std::condition_variable job_available_;
+    bool stopping_ = false;
+
+    /// jobs not picked up by a worker yet, at most one per requester
+    std::deque<std::shared_ptr<Job>> jobs_;
+    std::unordered_map<const void *, std::shared_ptr<Job>> queued_jobs_;
+
+    /// the ticket of the newest request of each requester that has not been delivered (or cancelled) yet
+    std::unordered_map<const void *, std::uint64_t> latest_tickets_;
+    std::uint64_t last_ticket_ = 0;
+
+    /// results waiting for the next deliver_results()
+    std::vector<Result> results_;
+
+    PathCache cache_;
+    int cache_hits_ = 0;
+    int cache_misses_ = 0;
+    int rejected_requests_ = 0;
+};
+
+} // namespace cute
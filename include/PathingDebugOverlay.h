@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Node.h"
+#include "PathingMap.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// A single QGraphicsItem that draws a PathingMap (an outline around every cell, filled cells shaded) along with
+/// the bounding boxes and the PathingMap bounds of Entities, for debugging.
+///
+/// Everything is painted by paint(), no item is created per cell or per Entity. When cells change, only their
+/// rects are scheduled for repainting (see cells_changed()), and paint() only draws the cells in the exposed rect.
+///
+/// The PathingMap is not copied, it has to outlive the overlay.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// PathingDebugOverlay *overlay = new PathingDebugOverlay(pathing_map);
+/// scene->addItem(overlay);
+/// pathing_map.fill(cell);
+/// overlay->cells_changed({cell});
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class PathingDebugOverlay : public QGraphicsItem {
+public:
+    PathingDebugOverlay(const PathingMap &pathing_map);
+
+    void cells_changed(const std::vector<Node> &cells);
+    void pathing_map_changed();
+    void set_entity_boxes(const std::vector<QPolygonF> &bounding_boxes, const std::vector<QRectF> &pathing_bounds);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+    void update_entity_boxes();
+
+private:
+    const PathingMap &pathing_map_;
+
+    std::vector<QPolygonF> entity_bounding_boxes_;
+    std::vector<QRectF> entity_pathing_bounds_;
+};
+
+} // namespace cute
@@ -1,12 +1,29 @@
 #pragma once
 
+#include "ClearanceMap.h"
+#include "ConnectedComponents.h"
 #include "PathGrid.h"
+#include "PathingOptions.h"
+#include "RowPrefixCounts.h"
 #include "Vendor.h"
 
 namespace cute {
 
 /// Represents a rectangular region of space divided into square cells where
 /// each cell can either be filled or unfilled.
+///
+/// Every PathingMap has a version. Any change to the filling moves it to a new version that no PathingMap
+/// has had before, copies keep the version of the original. So two PathingMaps with the same version
+/// have the same filling, which makes the version a cheap key for caching pathing results.
+///
+/// reachable() answers whether a path exists without searching, from ConnectedComponents that are built on
+/// first use and shared by copies. Filling or unfilling single cells (see change_filling()) keeps them up to
+/// date (unless a filled cell may have split an area), any other change drops them until they are needed again.
+/// Since they are built lazily, call reachable() on a PathingMap from one thread at a time (a snapshot handed to
+/// worker threads may still be searched in by them meanwhile).
+/// The same goes for clearance_map(), which searches for agents bigger than one cell use, and for the
+/// RowPrefixCounts that answer filled(QRectF)/free(QRectF) with two lookups per row (both kept up to date by
+/// change_filling(), like the ConnectedComponents).
 
 class PathingMap {
 public:
@@ -37,8 +54,20 @@ public:
 
     bool free(const QRectF &region) const;
 
-    std::vector<QPointF> shortest_path(const Node &fromCell, const Node &toCell) const;
-    std::vector<QPointF> shortest_path(const QPointF &fromPt, const QPointF &toPt) const;
+    bool reachable(const Node &from_cell, const Node &to_cell) const;
+    bool reachable(const QPointF &from_pt, const QPointF &to_pt) const;
+
+    const ConnectedComponents &connected_components() const;
+    const ClearanceMap &clearance_map() const;
+    const RowPrefixCounts &row_prefix_counts() const;
+    int num_filled(const Node &top_left, const Node &bottom_right) const;
+
+    std::vector<QPointF> shortest_path(const Node &fromCell, const Node &toCell,
+                                       const PathingOptions &options = PathingOptions(),
+                                       PathStatus *status = nullptr) const;
+    std::vector<QPointF> shortest_path(const QPointF &fromPt, const QPointF &toPt,
+                                       const PathingOptions &options = PathingOptions(),
+                                       PathStatus *status = nullptr) const;
 
     int width() const { return cell_size_ * num_cells_wide_; }
     int height() const { return cell_size_ * num_cells_long_; }
@@ -68,15 +97,35 @@ public:
     void unfill(const QRectF &region);
     void unfill();
 
+    void change_filling(const std::vector<Node> &cells_to_fill, const std::vector<Node> &cells_to_unfill);
     void set_filling(const std::vector<std::vector<int>> &vec);
     void set_filling(const PathingMap &another_pathmap, const QPointF &pos);
     void add_filling(const PathingMap &another_pathmap, const QPointF &pos);
+    std::vector<Node> footprint(const PathingMap &another_pathmap, const QPointF &pos) const;
+
+    const PathGrid &path_grid() const { return path_grid_; }
+
+    std::uint64_t version() const { return version_; }
+
+private:
+    static std::uint64_t new_version();
+    void filling_changed();
 
 private:
     PathGrid path_grid_;
     int num_cells_wide_;
     int num_cells_long_;
     int cell_size_;
+    std::uint64_t version_;
+
+    /// labels of the current filling, null until reachable() needs them (copies share them, see fill()/unfill())
+    mutable std::shared_ptr<ConnectedComponents> components_;
+
+    /// clearance of the current filling, null until clearance_map() is called (copies share it)
+    mutable std::shared_ptr<ClearanceMap> clearance_;
+
+    /// filled cell counts of the current filling, null until a region is checked (copies share it)
+    mutable std::shared_ptr<RowPrefixCounts> row_prefix_counts_;
 };
 
 } // namespace cute
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Vendor.h"
+
+namespace cute {
+
+/// How a path search ended, see PathingMap::shortest_path().
+///
+/// - Found: the path leads to the target.
+/// - Partial: the target can't be reached, the path leads to the reachable cell closest to it instead
+///   (only with PathingOptions::closest_reachable_fallback).
+/// - Unreachable: the target can't be reached (and there is no closer cell to go to instead), the path is empty.
+/// - BudgetExceeded: the search was stopped by PathingOptions::max_expansions or max_milliseconds. With
+///   closest_reachable_fallback the path leads to the cell closest to the target found so far, otherwise it's empty.
+/// clang-format off
+enum class PathStatus { Found, Partial, Unreachable, BudgetExceeded };
+/// clang-format on
+
+/// Tells PathingMap::shortest_path() (and the PathGrid it wraps) how to search for a path.
+///
+/// The default constructed options give the classic behavior: a plain A* search over 4-connected cells.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// PathingOptions options;
+/// options.algorithm = PathingOptions::Algorithm::JumpPointSearch;
+/// options.movement = PathingOptions::Movement::EightDirections;
+/// std::vector<QPointF> path = map->pathing_map().shortest_path(from, to, options);
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+struct PathingOptions {
+    /// clang-format off
+    enum class Algorithm { AStar, JumpPointSearch };
+    enum class Movement { FourDirections, EightDirections };
+    /// clang-format on
+
+    /// JumpPointSearch finds paths just as short as AStar, but it skips over the "symmetric" parts of open
+    /// areas, so it expands far fewer cells. (With EightDirections and allow_corner_cutting, A* is used instead.)
+    Algorithm algorithm = Algorithm::AStar;
+
+    /// With EightDirections a path may also step diagonally. Moves are priced with octile costs
+    /// (straight_move_cost and diagonal_move_cost, roughly 1 : sqrt(2)) and the heuristic is the octile distance.
+    Movement movement = Movement::FourDirections;
+
+    /// Only used with EightDirections. If false, a diagonal step needs both cells it passes between to be
+    /// unfilled (so an entity never clips the corner of a filled cell). If true, one unfilled cell is enough.
+    /// A diagonal step between two filled cells is never allowed.
+    bool allow_corner_cutting = false;
+
+    /// Stop searching after this many cells were expanded (0 for no limit).
+    int max_expansions = 0;
+
+    /// Stop searching after this many milliseconds (0 for no limit).
+    int max_milliseconds = 0;
+
+    /// If the target can't be reached (or the search runs out of budget), return a path to the cell closest
+    /// to the target instead of an empty path.
+    bool closest_reachable_fallback = false;
+
+    /// Reduce the path to its corner points: a cell is dropped whenever the straight line past it doesn't touch
+    /// a filled cell (see PathGrid::smooth_path()). Consecutive points are then no longer neighbors, and the path
+    /// may go in any direction, even with FourDirections.
+    bool smooth_path = false;
+
+    /// The size (in cells) of the square the moving agent covers, with the agent's top left cell on the path.
+    /// With an agent_size above 1, a cell can only be stepped onto if the agent fits there (see ClearanceMap),
+    /// and A* is used whatever the algorithm.
+    int agent_size = 1;
+
+    static const int straight_move_cost = 10;
+    static const int diagonal_move_cost = 14;
+};
+
+inline bool operator==(const PathingOptions &lhs, const PathingOptions &rhs) {
+    return lhs.algorithm == rhs.algorithm && lhs.movement == rhs.movement &&
+           lhs.allow_corner_cutting == rhs.allow_corner_cutting && lhs.max_expansions == rhs.max_expansions &&
+           lhs.max_milliseconds == rhs.max_milliseconds &&
+           lhs.closest_reachable_fallback == rhs.closest_reachable_fallback && lhs.smooth_path == rhs.smooth_path &&
+           lhs.agent_size == rhs.agent_size;
+}
+
+inline bool operator!=(const PathingOptions &lhs, const PathingOptions &rhs) { return !(lhs == rhs); }
+
+} // namespace cute
+
+Q_DECLARE_METATYPE(cute::PathingOptions);
+Q_DECLARE_METATYPE(cute::PathStatus);
@@ -8,6 +8,7 @@ class QColor;
 class QSize;
 class QPointF;
 class QRectF;
+class QPolygonF;
 
 namespace cute {
 
@@ -22,6 +23,11 @@ namespace QtUtils {
 QPixmap pixmap_from_color(QSize size, QColor color);
 double distance(QPointF p1, QPointF p2);
 
+bool is_convex(const QPolygonF &polygon);
+bool intersects(const QPolygonF &polygon1, const QPolygonF &polygon2);
+bool intersects(const QPolygonF &polygon, const QRectF &rect);
+bool contains(const QPolygonF &polygon, const QPointF &point);
+
 } // namespace QtUtils
 
 } // namespace cute
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "PathGrid.h"
+#include "Vendor.h"
+
+namespace cute {
+
+/// The number of filled cells left of every cell of a PathGrid, counted row by row (a prefix count per row),
+/// so the number of filled cells in a rectangular region is found with two lookups per row, no matter how wide
+/// the region is.
+///
+/// Since the rows are counted on their own, a changed cell only changes the counts of its own row:
+/// update_row() counts a row again in a single pass over it, instead of counting every row again.
+///
+/// Example usage:
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~.cpp
+/// RowPrefixCounts counts(grid);
+/// if (counts.num_filled(Node(2, 2), Node(5, 5)) == 0) {
+///     /// the 4x4 region is free
+/// }
+/// grid.fill(Node(3, 7));
+/// counts.update_row(grid, 7);
+/// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+class RowPrefixCounts {
+public:
+    RowPrefixCounts(const PathGrid &grid);
+
+    int num_filled(const Node &top_left, const Node &bottom_right) const;
+    void update_row(const PathGrid &grid, int y);
+
+    int num_cols() const { return num_cols_; }
+    int num_rows() const { return num_rows_; }
+
+private:
+    int num_cols_;
+    int num_rows_;
+
+    /// (num_cols + 1) x num_rows, entry (x,y) is the number of filled cells of row y left of cell (x,y)
+    /// (exclusive), so the first column is 0
+    std::vector<int> counts_;
+};
+
+} // namespace cute
@@ -1,15 +1,26 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
+#include <deque>
+#include <functional>
 #include <iterator>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <time.h>
 #include <typeindex>
 #include <typeinfo>
@@ -20,6 +31,7 @@
 
 #include <QBrush>
 #include <QColor>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QFont>
 #include <QGraphicsItem>
@@ -39,16 +51,20 @@
 #include <QMetaType>
 #include <QMouseEvent>
 #include <QObject>
+#include <QPainter>
 #include <QPen>
 #include <QPixmap>
 #include <QPoint>
 #include <QPointF>
 #include <QPointer>
 #include <QPolygonF>
+#include <QRect>
 #include <QRectF>
 #include <QSize>
 #include <QSizeF>
+#include <QStyleOptionGraphicsItem>
 #include <QThread>
 #include <QTimer>
+#include <QtAlgorithms>
 #include <QtGlobal>
 #include <QtMath>
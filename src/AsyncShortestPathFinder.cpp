@@ -3,25 +3,77 @@
 using namespace cute;
 
 /// Calculates a Path from a starting point to an ending point in the specified PathingMap.
-void Worker::find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end) {
+void Worker::find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end,
+                       const PathingOptions &options) {
+    PathStatus status;
     std::vector<QPointF> path_points;
-    path_points = pathing_map.shortest_path(start, end);
-    emit path_found(path_points);
+    path_points = pathing_map.shortest_path(start, end, options, &status);
+    emit path_found(path_points, status);
 }
 
 AsyncShortestPathFinder::AsyncShortestPathFinder() {
     worker_.moveToThread(&worker_thread_);
     connect(&worker_, &Worker::path_found, this, &AsyncShortestPathFinder::on_path_found);
-    connect(this, &AsyncShortestPathFinder::find_path, &worker_, &Worker::find_path);
+    connect(this, &AsyncShortestPathFinder::path_requested, &worker_, &Worker::find_path);
+    connect(this, &AsyncShortestPathFinder::cached_path_found, this, &AsyncShortestPathFinder::path_found,
+            Qt::QueuedConnection);
     worker_thread_.start();
 }
 
 AsyncShortestPathFinder::~AsyncShortestPathFinder() {
     worker_thread_.quit();
-    /// TODO: the main thread sometimes blocks here (when the pathmap of the entity is big), fix the bug
-    /// I guess the reason is that `pathing_map.shortest_path` never returns in the child thread.
-    /// if the path can not be calculated by the A* algorighm, the `shortest_path` function will not return.
+    /// `pathing_map.shortest_path` returns an empty path when the target can not be reached (and stops early when
+    /// the options have a budget), so the worker always finishes its current request and this wait returns.
     worker_thread_.wait();
 }
 
-void AsyncShortestPathFinder::on_path_found(std::vector<QPointF> path) { emit path_found(path); }
+/// Finds the path between the specified points, path_found() is emitted with the result later on
+/// (never before this function returns).
+void AsyncShortestPathFinder::find_path(const PathingMap &pathing_map, const QPointF &start, const QPointF &end,
+                                        const PathingOptions &options) {
+    PathCache::Key key{pathing_map.point_to_cell(start), pathing_map.point_to_cell(end), pathing_map.version(),
+                       options};
+
+    std::vector<QPointF> path;
+    PathStatus status;
+    if (cache_.find(key, path, status)) {
+        cache_hits_++;
+
+        /// results are emitted in request order, so wait behind the requests the worker is still busy with
+        if (pending_requests_.empty()) {
+            emit cached_path_found(path, status);
+        } else {
+            pending_requests_.push_back({key, true, path, status});
+        }
+        return;
+    }
+
+    cache_misses_++;
+    pending_requests_.push_back({key, false, std::vector<QPointF>(), PathStatus::Unreachable});
+    /// the queued connection copies the PathingMap here, on the calling thread, so the worker only ever sees a
+    /// snapshot of it (the copy shares its bits until the caller changes its own map)
+    emit path_requested(pathing_map, start, end, options);
+}
+
+/// Executed when the worker has found a path, the worker answers requests in the order they were made.
+void AsyncShortestPathFinder::on_path_found(std::vector<QPointF> path, PathStatus status) {
+    for (PendingRequest &request : pending_requests_) {
+        if (!request.done) {
+            request.done = true;
+            request.path = path;
+            request.status = status;
+            /// running out of budget depends on the machine (and its load), so only final answers are cached
+            if (status != PathStatus::BudgetExceeded) {
+                cache_.insert(request.key, path, status);
+            }
+            break;
+        }
+    }
+
+    while (!pending_requests_.empty() && pending_requests_.front().done) {
+        std::vector<QPointF> result = std::move(pending_requests_.front().path);
+        PathStatus result_status = pending_requests_.front().status;
+        pending_requests_.pop_front();
+        emit path_found(result, result_status);
+    }
+}
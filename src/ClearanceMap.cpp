@@ -0,0 +1,79 @@
+#include "ClearanceMap.h"
+
+using namespace cute;
+
+ClearanceMap::ClearanceMap(const PathGrid &grid) : num_cols_(grid.num_cols()), num_rows_(grid.num_rows()) {
+    clearance_.assign(static_cast<size_t>(num_cols_) * num_rows_, 0);
+    for (int y = num_rows_ - 1; y >= 0; y--) {
+        for (int x = num_cols_ - 1; x >= 0; x--) {
+            clearance_[static_cast<size_t>(y) * num_cols_ + x] = compute(grid, x, y);
+        }
+    }
+}
+
+/// Brings the clearance up to date with the specified grid, which must be the grid the ClearanceMap was built
+/// from (or last updated with) after the specified cells changed.
+///
+/// Only the changed cells are computed again at first. Whenever a cell's clearance changes, its left, upper and
+/// upper left neighbors are computed again as well. So the cost is proportional to the number of cells whose
+/// clearance changes, not to the size of the grid.
+void ClearanceMap::update(const PathGrid &grid, const std::vector<Node> &changed_cells) {
+    assert(grid.num_cols() == num_cols_ && grid.num_rows() == num_rows_);
+
+    /// cell ids, highest first: a cell only depends on cells with higher ids (right of it and below it), so those
+    /// are final by the time it is computed again. A cell queued more than once comes out several times in a row.
+    std::priority_queue<int> cells_to_compute;
+    for (const Node &cell : changed_cells) {
+        if (grid.contains(cell)) {
+            cells_to_compute.push(cell.y() * num_cols_ + cell.x());
+        }
+    }
+
+    int last_cell = -1;
+    while (!cells_to_compute.empty()) {
+        int cell = cells_to_compute.top();
+        cells_to_compute.pop();
+        if (cell == last_cell) {
+            continue;
+        }
+        last_cell = cell;
+
+        int x = cell % num_cols_;
+        int y = cell / num_cols_;
+        int value = compute(grid, x, y);
+        if (value == clearance_[cell]) {
+            continue;
+        }
+        clearance_[cell] = value;
+        if (x > 0) {
+            cells_to_compute.push(cell - 1);
+        }
+        if (y > 0) {
+            cells_to_compute.push(cell - num_cols_);
+        }
+        if (x > 0 && y > 0) {
+            cells_to_compute.push(cell - num_cols_ - 1);
+        }
+    }
+}
+
+/// Returns the clearance of the specified cell, 0 if it is filled or outside of the grid.
+int ClearanceMap::clearance(int x, int y) const {
+    if (x < 0 || y < 0 || x >= num_cols_ || y >= num_rows_) {
+        return 0;
+    }
+    return clearance_[static_cast<size_t>(y) * num_cols_ + x];
+}
+
+/// Returns the clearance the specified cell should have, given the clearance of the cells right of it and below it.
+int ClearanceMap::compute(const PathGrid &grid, int x, int y) const {
+    if (grid.filled(x, y)) {
+        return 0;
+    }
+    /// cells outside of the grid have no clearance
+    int right = clearance(x + 1, y);
+    int down = clearance(x, y + 1);
+    int down_right = clearance(x + 1, y + 1);
+    const int max_clearance = std::numeric_limits<std::uint16_t>::max();
+    return std::min(1 + std::min(right, std::min(down, down_right)), max_clearance);
+}
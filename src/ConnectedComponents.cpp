@@ -0,0 +1,199 @@
+#include "ConnectedComponents.h"
+
+using namespace cute;
+
+ConnectedComponents::ConnectedComponents(const PathGrid &grid)
+        : num_cols_(grid.num_cols()), num_rows_(grid.num_rows()) {
+    size_t num_cells = static_cast<size_t>(num_cols_) * num_rows_;
+    cell_nodes_.assign(num_cells, -1);
+    parent_.assign(num_cells, -1);
+    size_.assign(num_cells, 1);
+
+    for (int y = 0; y < num_rows_; y++) {
+        for (int x = 0; x < num_cols_; x++) {
+            if (grid.filled(x, y)) {
+                continue;
+            }
+            int cell = y * num_cols_ + x;
+            cell_nodes_[cell] = cell;
+            parent_[cell] = cell;
+            num_components_++;
+            if (x > 0 && cell_nodes_[cell - 1] != -1) {
+                join(cell, cell - 1);
+            }
+            if (y > 0 && cell_nodes_[cell - num_cols_] != -1) {
+                join(cell, cell - num_cols_);
+            }
+        }
+    }
+
+    /// flatten the forest, so finding the root of any cell is a single step
+    for (size_t node = 0; node < num_cells; node++) {
+        if (parent_[node] != -1) {
+            parent_[node] = find(node);
+        }
+    }
+}
+
+/// Returns true if `to` can be reached from `from`, following the same rules as PathGrid::shortest_path():
+/// the cells in between must be unfilled, `from` and `to` themselves may be filled.
+/// Returns false if either cell is outside the grid.
+bool ConnectedComponents::reachable(const Node &from, const Node &to) const {
+    if (from.x() < 0 || from.y() < 0 || from.x() >= num_cols_ || from.y() >= num_rows_ || to.x() < 0 ||
+        to.y() < 0 || to.x() >= num_cols_ || to.y() >= num_rows_) {
+        return false;
+    }
+    if (from == to || abs(from.x() - to.x()) + abs(from.y() - to.y()) == 1) {
+        return true;
+    }
+
+    int from_roots[4];
+    int to_roots[4];
+    int num_from_roots = roots_around(from, from_roots);
+    int num_to_roots = roots_around(to, to_roots);
+    for (int i = 0; i < num_from_roots; i++) {
+        for (int j = 0; j < num_to_roots; j++) {
+            if (from_roots[i] == to_roots[j]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/// Updates the labels for the specified cell having been unfilled in `grid` (the grid after the change).
+void ConnectedComponents::unfill(const PathGrid &grid, const Node &cell) {
+    int cell_id = cell.y() * num_cols_ + cell.x();
+    if (cell_nodes_[cell_id] != -1) {
+        return;
+    }
+
+    /// the node of a cell that was taken out by fill() is still in the forest, the cell needs a new one
+    int node = cell_id;
+    if (parent_[node] != -1) {
+        if (parent_.size() >= 2 * cell_nodes_.size()) {
+            *this = ConnectedComponents(grid);
+            return;
+        }
+        node = parent_.size();
+        parent_.push_back(node);
+        size_.push_back(1);
+    }
+    parent_[node] = node;
+    size_[node] = 1;
+    cell_nodes_[cell_id] = node;
+    num_components_++;
+
+    const int dx[] = {0, 0, -1, 1};
+    const int dy[] = {-1, 1, 0, 0};
+    for (int i = 0; i < 4; i++) {
+        int nx = cell.x() + dx[i];
+        int ny = cell.y() + dy[i];
+        if (nx >= 0 && ny >= 0 && nx < num_cols_ && ny < num_rows_ && cell_nodes_[ny * num_cols_ + nx] != -1) {
+            join(node, cell_nodes_[ny * num_cols_ + nx]);
+        }
+    }
+}
+
+/// Updates the labels for the specified cell having been filled. Returns false if that may have split the area
+/// of the cell, the labels are out of date then and have to be built again.
+bool ConnectedComponents::fill(const Node &cell) {
+    int cell_id = cell.y() * num_cols_ + cell.x();
+    if (cell_nodes_[cell_id] == -1) {
+        return true;
+    }
+    if (!free_around_connected(cell)) {
+        return false;
+    }
+
+    /// a cell without unfilled neighbors was an area of its own
+    int roots[4];
+    if (roots_around_neighbors(cell, roots) == 0) {
+        num_components_--;
+    }
+    cell_nodes_[cell_id] = -1;
+    return true;
+}
+
+/// Returns the root of the tree of the specified node. Trees are kept shallow by joining them by size,
+/// so this is a step or two even after many unfill()s.
+int ConnectedComponents::find(int node) const {
+    while (parent_[node] != node) {
+        node = parent_[node];
+    }
+    return node;
+}
+
+/// Joins the trees of the two nodes, hanging the smaller tree under the root of the bigger one.
+void ConnectedComponents::join(int node0, int node1) {
+    int root0 = find(node0);
+    int root1 = find(node1);
+    if (root0 == root1) {
+        return;
+    }
+    if (size_[root0] < size_[root1]) {
+        std::swap(root0, root1);
+    }
+    parent_[root1] = root0;
+    size_[root0] += size_[root1];
+    num_components_--;
+}
+
+/// Puts the roots of the areas a path can leave (or enter) the specified cell through into `roots` and returns
+/// how many there are: the cell's own area if it is unfilled, else the areas of its unfilled neighbors.
+int ConnectedComponents::roots_around(const Node &cell, int roots[4]) const {
+    int node = cell_nodes_[cell.y() * num_cols_ + cell.x()];
+    if (node != -1) {
+        roots[0] = find(node);
+        return 1;
+    }
+    return roots_around_neighbors(cell, roots);
+}
+
+/// Puts the roots of the areas of the unfilled neighbors of the specified cell into `roots`, returns how many.
+int ConnectedComponents::roots_around_neighbors(const Node &cell, int roots[4]) const {
+    const int dx[] = {0, 0, -1, 1};
+    const int dy[] = {-1, 1, 0, 0};
+    int num_roots = 0;
+    for (int i = 0; i < 4; i++) {
+        int nx = cell.x() + dx[i];
+        int ny = cell.y() + dy[i];
+        if (nx >= 0 && ny >= 0 && nx < num_cols_ && ny < num_rows_ && cell_nodes_[ny * num_cols_ + nx] != -1) {
+            roots[num_roots++] = find(cell_nodes_[ny * num_cols_ + nx]);
+        }
+    }
+    return num_roots;
+}
+
+/// Returns true if the unfilled neighbors of the specified cell are connected through the 8 cells around it,
+/// i.e. a path that passed the cell can go around it instead. The cells around are walked in a circle, where
+/// each one touches the next, so that is the case if the neighbors all lie on one run of unfilled cells.
+bool ConnectedComponents::free_around_connected(const Node &cell) const {
+    /// up, then clockwise, so the neighbors have even indices
+    const int dx[] = {0, 1, 1, 1, 0, -1, -1, -1};
+    const int dy[] = {-1, -1, 0, 1, 1, 1, 0, -1};
+    bool free[8];
+    int num_free = 0;
+    for (int i = 0; i < 8; i++) {
+        int nx = cell.x() + dx[i];
+        int ny = cell.y() + dy[i];
+        free[i] = nx >= 0 && ny >= 0 && nx < num_cols_ && ny < num_rows_ && cell_nodes_[ny * num_cols_ + nx] != -1;
+        num_free += free[i];
+    }
+    if (num_free == 8) {
+        return true;
+    }
+
+    int num_runs_with_neighbors = 0;
+    for (int start = 0; start < 8; start++) {
+        if (!free[start] || free[(start + 7) % 8]) {
+            continue;
+        }
+        bool has_neighbor = false;
+        for (int i = start; free[i % 8]; i++) {
+            has_neighbor = has_neighbor || i % 2 == 0;
+        }
+        num_runs_with_neighbors += has_neighbor;
+    }
+    return num_runs_with_neighbors <= 1;
+}
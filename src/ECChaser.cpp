@@ -59,6 +59,10 @@ void ECChaser::start_chasing() { FOV_emitter_->turn_on(); }
 
 void ECChaser::set_show_FOV(bool tf) { FOV_emitter_->set_show_FOV(tf); }
 
+void ECChaser::set_pathing_mode(ECPathMover::PathingMode mode) { path_mover_->set_pathing_mode(mode); }
+
+ECPathMover::PathingMode ECChaser::pathing_mode() const { return path_mover_->pathing_mode(); }
+
 void ECChaser::on_entity_enter_FOV(Entity *entity) {
     /// if the controlled entity already has a target entity, do nothing
     if (target_entity_ != nullptr) {
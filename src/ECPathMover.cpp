@@ -1,24 +1,43 @@
 #include "ECPathMover.h"
-#include "AsyncShortestPathFinder.h"
 #include "ECRotater.h"
 #include "EntitySprite.h"
 #include "Map.h"
+#include "PathService.h"
 #include "Sprite.h"
 #include "Utilities.h"
 
 using namespace cute;
 
-ECPathMover::ECPathMover(Entity *entity) : ECMover(entity), pf_(new AsyncShortestPathFinder()) {
+ECPathMover::ECPathMover(Entity *entity) : ECMover(entity) {
     move_timer_ = new QTimer(this);
     rotater_ = new ECRotater(entity);
-    connect(pf_.get(), &AsyncShortestPathFinder::path_found, this, &ECPathMover::on_path_calculated);
 }
 
-/// Executed when the async path finder has succesfully calculated a requested path.
+/// A path that is still being searched for must not be delivered to a destroyed mover.
+/// (If the path service was never created, or is gone with the application, there is nothing to cancel.)
+ECPathMover::~ECPathMover() {
+    PathService *service = PathService::existing();
+    if (service != nullptr) {
+        service->cancel(this);
+    }
+}
+
+/// Sets how move_entity() finds its paths, applies to the next move_entity() (see PathingMode).
+void ECPathMover::set_pathing_mode(PathingMode mode) {
+    pathing_mode_ = mode;
+    if (mode != PathingMode::Incremental) {
+        incremental_planner_.reset();
+    } else if (incremental_planner_ == nullptr) {
+        incremental_planner_.reset(new IncrementalPathPlanner(pathing_options_));
+    }
+}
+
+/// Executed when the path service has calculated a requested path.
 /// Will start the timer to make the entity move on the path.
-void ECPathMover::on_path_calculated(std::vector<QPointF> path) {
+void ECPathMover::on_path_calculated(std::vector<QPointF> path, PathStatus status) {
     /// stop/clear previous movement
     stop_moving_entity();
+    emit path_search_finished(status);
 
     /// if entity to move is dead by now, do nothing
     Entity *ent = entity();
@@ -29,6 +48,9 @@ void ECPathMover::on_path_calculated(std::vector<QPointF> path) {
     if (path.size() == 0 || path.size() == 1) {
         return;
     }
+    /// the entity stops one cell short of the end of its path (the target is often what it walks up to, e.g. an
+    /// entity standing there); a partial path is shortened the same way, so the entity ends up just as close to
+    /// the cell it stops at whether or not its target could be reached
     path.pop_back();
 
     /// set up variables for new path
@@ -87,13 +109,61 @@ void ECPathMover::move_entity_(const QPointF &to_pos) {
     Map *entitys_map = entity()->map();
     assert(entitys_map != nullptr);
 
-    /// tell async path finder to start finding path to the pos,
-    /// when found, the path finder will emit an event (which we listen to)
-    pf_->find_path(entitys_map->pathing_map(), entity()->pos(), to_pos);
+    /// an entity that fills more than one cell needs room for all of them along the path
+    PathingOptions options = pathing_options_;
+    options.agent_size = std::max(options.agent_size, footprint_size());
+
+    if (pathing_mode_ == PathingMode::Hierarchical) {
+        PathStatus status;
+        std::vector<QPointF> path = entitys_map->hierarchical_shortest_path(entity()->pos(), to_pos, options, &status);
+        on_path_calculated(path, status);
+        return;
+    }
+
+    if (pathing_mode_ == PathingMode::Incremental) {
+        /// the planner's search is only valid for the options it was started with
+        if (incremental_planner_->options() != options) {
+            incremental_planner_.reset(new IncrementalPathPlanner(options));
+        }
+        Node from_cell = entitys_map->point_to_cell(entity()->pos());
+        Node to_cell = entitys_map->point_to_cell(to_pos);
+        PathStatus status;
+        std::vector<QPointF> path;
+        for (const Node &cell : incremental_planner_->shortest_path(entitys_map->pathing_map().path_grid(), from_cell,
+                                                                    to_cell, &status)) {
+            path.push_back(entitys_map->cell_to_point(cell));
+        }
+        on_path_calculated(path, status);
+        return;
+    }
+
+    if (pathing_mode_ == PathingMode::FlowField) {
+        std::shared_ptr<const FlowField> field = entitys_map->flow_field(to_pos, options);
+        std::vector<QPointF> path;
+        for (const Node &cell : field->path(entitys_map->point_to_cell(entity()->pos()))) {
+            path.push_back(entitys_map->cell_to_point(cell));
+        }
+        on_path_calculated(path, path.empty() ? PathStatus::Unreachable : PathStatus::Found);
+        return;
+    }
+
+    /// ask the path service to start finding path to the pos (replacing the previous request, if any),
+    /// when found, the path service will call us back. The entity's own footprint is left out of the
+    /// searched map, it would be in the entity's way otherwise.
+    std::shared_ptr<const PathingMap> snapshot = entitys_map->pathing_map_snapshot(&entity()->pathing_map(),
+                                                                                   options.agent_size > 1);
+    PathService::instance()->request_path(this, snapshot, entity()->pos(), to_pos, options,
+                                          [this](std::vector<QPointF> path, PathStatus status) {
+                                              on_path_calculated(path, status);
+                                          });
 }
 
 /// This function is executed when the MoveBehavior is asked to stop moving the entity.
 void ECPathMover::stop_moving_entity_() {
+    PathService *service = PathService::existing();
+    if (service != nullptr) {
+        service->cancel(this);
+    }
     move_timer_->disconnect();
     points_to_follow_.clear();
     target_point_index_ = 0;
@@ -111,6 +181,28 @@ void ECPathMover::stop_moving_entity_() {
     }
 }
 
+/// Returns the size (in cells of the Map) of the smallest square around the cells the entity's PathingMap fills
+/// in its Map, 1 if it fills none.
+int ECPathMover::footprint_size() {
+    Entity *ent = entity();
+    std::vector<Node> footprint = ent->map()->pathing_map().footprint(ent->pathing_map(),
+                                                                      ent->map_to_map(ent->pathing_map_pos()));
+    if (footprint.empty()) {
+        return 1;
+    }
+    int min_x = footprint[0].x();
+    int max_x = min_x;
+    int min_y = footprint[0].y();
+    int max_y = min_y;
+    for (const Node &cell : footprint) {
+        min_x = std::min(min_x, cell.x());
+        max_x = std::max(max_x, cell.x());
+        min_y = std::min(min_y, cell.y());
+        max_y = std::max(max_y, cell.y());
+    }
+    return std::max(max_x - min_x, max_y - min_y) + 1;
+}
+
 bool ECPathMover::target_point_reached() {
     /// if there are no target points, return true
     if (points_to_follow_.size() == 0) {
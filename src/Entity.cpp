@@ -70,6 +70,7 @@ void Entity::set_pos(const QPointF &new_pos) {
     map_->remove_pathing_map(pathing_map());
     map_->add_pathing_map(pathing_map(), map_to_map(pathing_map_pos_));
     map_->update_pathing_map();
+    map_->update_entity_bounds(this);
 
     /// update z value (lower in map -> draw higher on top)
     qreal bot = map_to_map(bounding_rect().bottomRight()).y();
@@ -114,6 +115,9 @@ void Entity::set_z(double z) {
     if (sprite_ != nullptr) {
         scale_based_on_z();
     }
+    if (map_ != nullptr) {
+        map_->update_entity_bounds(this);
+    }
 }
 
 /// This does *not* delete the old sprite. You are responsible for the old sprite's lifetime.
@@ -145,11 +149,25 @@ void Entity::set_sprite(EntitySprite *sprite, bool auto_set_origin_and_bounding_
     /// set internal sprite_ pointer to the new sprite
     sprite_ = sprite;
     scale_based_on_z();
+
+    if (map_ != nullptr) {
+        map_->update_entity_bounds(this);
+    }
+}
+
+void Entity::set_bounding_rect(const QRectF &rect) {
+    bounding_rect_ = rect;
+    if (map_ != nullptr) {
+        map_->update_entity_bounds(this);
+    }
 }
 
 void Entity::set_bounding_box_and_update_origin(const QRectF &rect) {
     bounding_rect_ = rect;
     set_origin(rect.center());
+    if (map_ != nullptr) {
+        map_->update_entity_bounds(this);
+    }
 }
 
 void Entity::add_sound(const std::string &sound_name, const std::string &file_path) {
@@ -191,6 +209,10 @@ void Entity::set_facing_angle(double angle) {
     if (sprite_) {
         sprite_->set_facing_angle(angle);
     }
+    /// the sprite (of a TopDownSprite) turns with the Entity, and the bounds in the map with it
+    if (map_ != nullptr) {
+        map_->update_entity_bounds(this);
+    }
 }
 
 void Entity::face_point(const QPointF &point) {
@@ -205,25 +227,18 @@ void Entity::set_cell_pos(const Node &cell) {
     set_pos(map_->pathing_map().cell_to_point(cell));
 }
 
-/// TODO: move out into a non member utility function
+/// Returns true if the Entity can be moved to the specified position: its position and the filled cells of its
+/// PathingMap (moved along with it) must be free in the Map, not counting the Entity's own PathingMap.
+/// The Map is not modified.
 bool Entity::can_fit(const QPointF &at_pos) {
     /// if the point is out of map, return false
     if (map_ == nullptr || !map_->contains(at_pos)) {
         return false;
     }
 
-    // /// temporarly remove own pathing map
-    map_->remove_pathing_map(pathing_map());
-    map_->update_pathing_map();
-
-    // bool can = map_->pathing_map().can_fit(pathing_map(), at_pos);
-    bool can = !map_->pathing_map().filled(at_pos);
-
-    // /// put own pathing map back
-    map_->add_pathing_map(pathing_map(), map_to_map(pathing_map_pos_));
-    map_->update_pathing_map();
-
-    return can;
+    PathingMap &own = pathing_map();
+    QPointF pathing_map_offset = map_to_map(pathing_map_pos_) - pos();
+    return map_->free(at_pos, &own) && map_->can_fit(own, at_pos + pathing_map_offset, &own);
 }
 
 /// When a parent Entity moves, rotates, gets added to a Map, gets removed from a Map, or gets deleted,
@@ -236,6 +251,9 @@ void Entity::set_parent_entity(Entity *parent) {
             parent_ = nullptr;
         }
         sprite_->sprite_->setParentItem(nullptr);
+        if (map_ != nullptr) {
+            map_->update_entity_bounds(this);
+        }
         return;
     }
 
@@ -246,6 +264,9 @@ void Entity::set_parent_entity(Entity *parent) {
     parent_ = parent;
     parent_->children_.insert(this);
     sprite_->sprite_->setParentItem(parent->sprite()->sprite_);
+    if (map_ != nullptr) {
+        map_->update_entity_bounds(this);
+    }
 }
 
 bool Entity::has_child_recursive(Entity *entity) const {
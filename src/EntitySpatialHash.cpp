@@ -0,0 +1,93 @@
+#include "EntitySpatialHash.h"
+
+using namespace cute;
+
+EntitySpatialHash::EntitySpatialHash(double bucket_size) : bucket_size_(bucket_size) { assert(bucket_size > 0); }
+
+/// Adds the Entity with the specified bounds, or moves it to them if it was added before.
+/// Moving within the same buckets costs nothing.
+void EntitySpatialHash::update(Entity *entity, const QRectF &bounds) {
+    BucketRange range = bucket_range(bounds);
+    auto old_range = bucket_ranges_.find(entity);
+    if (old_range != bucket_ranges_.end()) {
+        if (old_range->second.top_left == range.top_left && old_range->second.bottom_right == range.bottom_right) {
+            return;
+        }
+        remove_from_buckets(entity, old_range->second);
+        old_range->second = range;
+    } else {
+        bucket_ranges_.emplace(entity, range);
+    }
+    add_to_buckets(entity, range);
+}
+
+void EntitySpatialHash::remove(Entity *entity) {
+    auto range = bucket_ranges_.find(entity);
+    if (range == bucket_ranges_.end()) {
+        return;
+    }
+    remove_from_buckets(entity, range->second);
+    bucket_ranges_.erase(range);
+}
+
+/// Returns the Entities in the buckets the region overlaps (a superset of the Entities overlapping the region).
+/// If the region covers more buckets than there are Entities, all the Entities are returned instead.
+std::unordered_set<Entity *> EntitySpatialHash::entities(const QRectF &region) const {
+    std::unordered_set<Entity *> result;
+    BucketRange range = bucket_range(region);
+    double num_buckets = (static_cast<double>(range.bottom_right.x()) - range.top_left.x() + 1) *
+                         (static_cast<double>(range.bottom_right.y()) - range.top_left.y() + 1);
+    if (num_buckets > bucket_ranges_.size()) {
+        for (const auto &entity_range : bucket_ranges_) {
+            result.insert(entity_range.first);
+        }
+        return result;
+    }
+
+    for (int y = range.top_left.y(); y <= range.bottom_right.y(); y++) {
+        for (int x = range.top_left.x(); x <= range.bottom_right.x(); x++) {
+            auto bucket = buckets_.find(Node(x, y));
+            if (bucket != buckets_.end()) {
+                result.insert(bucket->second.begin(), bucket->second.end());
+            }
+        }
+    }
+    return result;
+}
+
+EntitySpatialHash::BucketRange EntitySpatialHash::bucket_range(const QRectF &bounds) const {
+    QRectF normalized = bounds.normalized();
+    Node top_left(static_cast<int>(std::floor(normalized.left() / bucket_size_)),
+                  static_cast<int>(std::floor(normalized.top() / bucket_size_)));
+    Node bottom_right(static_cast<int>(std::floor(normalized.right() / bucket_size_)),
+                      static_cast<int>(std::floor(normalized.bottom() / bucket_size_)));
+    return BucketRange{top_left, bottom_right};
+}
+
+void EntitySpatialHash::add_to_buckets(Entity *entity, const BucketRange &range) {
+    for (int y = range.top_left.y(); y <= range.bottom_right.y(); y++) {
+        for (int x = range.top_left.x(); x <= range.bottom_right.x(); x++) {
+            buckets_[Node(x, y)].push_back(entity);
+        }
+    }
+}
+
+void EntitySpatialHash::remove_from_buckets(Entity *entity, const BucketRange &range) {
+    for (int y = range.top_left.y(); y <= range.bottom_right.y(); y++) {
+        for (int x = range.top_left.x(); x <= range.bottom_right.x(); x++) {
+            auto bucket = buckets_.find(Node(x, y));
+            if (bucket == buckets_.end()) {
+                continue;
+            }
+            std::vector<Entity *> &bucket_entities = bucket->second;
+            auto found = std::find(bucket_entities.begin(), bucket_entities.end(), entity);
+            if (found != bucket_entities.end()) {
+                *found = bucket_entities.back();
+                bucket_entities.pop_back();
+            }
+            if (bucket_entities.empty()) {
+                buckets_.erase(bucket);
+            }
+        }
+    }
+}
@@ -0,0 +1,281 @@
+#include "FlowField.h"
+
+using namespace cute;
+
+namespace {
+
+/// up, down, left, right, then the diagonals
+const int dx[] = {0, 0, -1, 1, -1, 1, -1, 1};
+const int dy[] = {-1, 1, 0, 0, -1, -1, 1, 1};
+
+} // namespace
+
+/// Builds the field by running Dijkstra backwards from the goal over the whole grid.
+///
+/// The moves allowed are symmetric (a diagonal step checks the same two cells in both directions), so
+/// searching from the goal outwards gives the same costs as searching from every cell towards the goal.
+FlowField::FlowField(const PathGrid &grid, const Node &goal, const PathingOptions &options)
+        : grid_(grid), goal_(goal), options_(options) {
+    build();
+}
+
+/// Builds the field of `previous` (same goal and movement rules) for the specified grid.
+///
+/// If the grid has the same size as the one `previous` was built from, the field is repaired: the cells whose
+/// way to the goal is cut by the changes lose their cost, then a search started from the cells around them and
+/// around the changed cells puts back the costs that got lower or got lost. Otherwise it is built anew.
+FlowField::FlowField(const FlowField &previous, const PathGrid &grid)
+        : grid_(grid), goal_(previous.goal_), options_(previous.options_) {
+    if (grid_.num_cols() != previous.grid_.num_cols() || grid_.num_rows() != previous.grid_.num_rows()) {
+        build();
+        return;
+    }
+    cost_ = previous.cost_;
+    next_ = previous.next_;
+    repair(previous.grid_.changed_cells(grid_));
+}
+
+/// Returns true if the goal can be reached from the specified cell.
+/// Filled cells (other than the goal) never are, but path() can still start from one.
+bool FlowField::reachable(const Node &cell) const { return cost(cell) != -1; }
+
+/// Returns the cost of the shortest path from the specified cell to the goal (in straight_move_cost and
+/// diagonal_move_cost units), -1 if the goal can't be reached from it.
+int FlowField::cost(const Node &cell) const {
+    if (!grid_.contains(cell)) {
+        return -1;
+    }
+    return cost_[cell.y() * grid_.num_cols() + cell.x()];
+}
+
+/// Returns the neighbor of the specified cell to step to in order to get closer to the goal.
+/// Returns the cell itself for the goal and for cells the goal can't be reached from.
+Node FlowField::next(const Node &cell) const {
+    if (!grid_.contains(cell)) {
+        return cell;
+    }
+    int next_cell = next_[cell.y() * grid_.num_cols() + cell.x()];
+    if (next_cell == -1) {
+        return cell;
+    }
+    return Node(next_cell % grid_.num_cols(), next_cell / grid_.num_cols());
+}
+
+/// Returns the shortest path from the specified cell to the goal, both included, like PathGrid::shortest_path().
+///
+/// `from` may be filled (e.g. by the Entity standing on it), the path then leaves it through its best neighbor.
+/// Returns an empty vector if `from` is the goal or if the goal can't be reached from it.
+std::vector<Node> FlowField::path(const Node &from) const {
+    std::vector<Node> path;
+    if (from == goal_ || !grid_.contains(from)) {
+        return path;
+    }
+
+    int num_cols = grid_.num_cols();
+    int cell = first_step(from);
+    if (cell == -1) {
+        return path;
+    }
+
+    path.push_back(from);
+    while (cell != -1) {
+        path.push_back(Node(cell % num_cols, cell / num_cols));
+        cell = next_[cell];
+    }
+    return path;
+}
+
+/// Searches the whole grid from the goal.
+void FlowField::build() {
+    size_t num_cells = static_cast<size_t>(grid_.num_cols()) * grid_.num_rows();
+    cost_.assign(num_cells, -1);
+    next_.assign(num_cells, -1);
+    if (!grid_.contains(goal_)) {
+        return;
+    }
+
+    int goal_cell = goal_.y() * grid_.num_cols() + goal_.x();
+    cost_[goal_cell] = 0;
+    std::vector<OpenEntry> open_nodes{{0, goal_cell}};
+    spread(open_nodes);
+}
+
+/// Brings cost_ and next_ (still those of the old grid) up to date with grid_, given the cells that changed.
+///
+/// The old costs are exact for the old grid. A cell keeps its cost if every step of its way to the goal is still
+/// allowed, that cost is then still the cost of a path, maybe not the shortest one anymore. The steps that can have
+/// gotten cheaper or allowed all start next to a changed cell, or next to a cell that lost its cost, so spreading
+/// from those cells leaves no cell with a neighbor that offers it a cheaper way: the costs are exact again.
+void FlowField::repair(const std::vector<Node> &changed_cells) {
+    int num_cols = grid_.num_cols();
+    int num_directions = (options_.movement == PathingOptions::Movement::EightDirections) ? 8 : 4;
+
+    /// the cells whose own step can't be taken anymore (a changed cell is in the way)...
+    std::vector<int> cut_cells;
+    for (const Node &changed : changed_cells) {
+        for (int y = changed.y() - 1; y <= changed.y() + 1; y++) {
+            for (int x = changed.x() - 1; x <= changed.x() + 1; x++) {
+                if (!grid_.contains(Node(x, y))) {
+                    continue;
+                }
+                int cell = y * num_cols + x;
+                if (cost_[cell] == -1) {
+                    continue;
+                }
+                if (!passable(x, y) || (next_[cell] != -1 && !step_allowed(cell, next_[cell]))) {
+                    cost_[cell] = -1;
+                    next_[cell] = -1;
+                    cut_cells.push_back(cell);
+                }
+            }
+        }
+    }
+
+    /// ...and all the cells whose way to the goal goes through them lose their cost
+    for (size_t i = 0; i < cut_cells.size(); i++) {
+        int x = cut_cells[i] % num_cols;
+        int y = cut_cells[i] / num_cols;
+        for (int d = 0; d < num_directions; d++) {
+            Node neighbor(x + dx[d], y + dy[d]);
+            if (!grid_.contains(neighbor)) {
+                continue;
+            }
+            int neighbor_cell = neighbor.y() * num_cols + neighbor.x();
+            if (next_[neighbor_cell] == cut_cells[i]) {
+                cost_[neighbor_cell] = -1;
+                next_[neighbor_cell] = -1;
+                cut_cells.push_back(neighbor_cell);
+            }
+        }
+    }
+
+    /// spread again from the cells that still have a cost around the changes and around the cut cells
+    std::vector<OpenEntry> open_nodes;
+    auto add_around = [&](int center_x, int center_y) {
+        for (int y = center_y - 1; y <= center_y + 1; y++) {
+            for (int x = center_x - 1; x <= center_x + 1; x++) {
+                if (grid_.contains(Node(x, y)) && cost_[y * num_cols + x] != -1) {
+                    open_nodes.push_back({cost_[y * num_cols + x], y * num_cols + x});
+                }
+            }
+        }
+    };
+    for (const Node &changed : changed_cells) {
+        add_around(changed.x(), changed.y());
+    }
+    for (int cell : cut_cells) {
+        add_around(cell % num_cols, cell / num_cols);
+    }
+    auto compare = [](const OpenEntry &lhs, const OpenEntry &rhs) { return lhs.first > rhs.first; };
+    std::make_heap(open_nodes.begin(), open_nodes.end(), compare);
+    spread(open_nodes);
+}
+
+/// Runs Dijkstra from the cells in the open list (a heap), lowering the cost of every cell a cheaper way is found
+/// for, until the open list is empty.
+void FlowField::spread(std::vector<OpenEntry> &open_nodes) {
+    int num_cols = grid_.num_cols();
+    int num_directions = (options_.movement == PathingOptions::Movement::EightDirections) ? 8 : 4;
+    auto compare = [](const OpenEntry &lhs, const OpenEntry &rhs) { return lhs.first > rhs.first; };
+
+    while (!open_nodes.empty()) {
+        std::pop_heap(open_nodes.begin(), open_nodes.end(), compare);
+        OpenEntry current = open_nodes.back();
+        open_nodes.pop_back();
+        if (current.first != cost_[current.second]) {
+            continue;
+        }
+
+        int x = current.second % num_cols;
+        int y = current.second / num_cols;
+        for (int i = 0; i < num_directions; i++) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (!passable(nx, ny)) {
+                continue;
+            }
+            int step_cost = PathingOptions::straight_move_cost;
+            if (i >= 4) {
+                if (!diagonal_step_allowed(x, y, dx[i], dy[i])) {
+                    continue;
+                }
+                step_cost = PathingOptions::diagonal_move_cost;
+            }
+
+            int neighbor = ny * num_cols + nx;
+            int neighbor_cost = current.first + step_cost;
+            if (cost_[neighbor] != -1 && cost_[neighbor] <= neighbor_cost) {
+                continue;
+            }
+            cost_[neighbor] = neighbor_cost;
+            next_[neighbor] = current.second;
+            open_nodes.push_back({neighbor_cost, neighbor});
+            std::push_heap(open_nodes.begin(), open_nodes.end(), compare);
+        }
+    }
+}
+
+/// A cell can be walked on if it is in the grid and unfilled. The goal can always be walked on.
+bool FlowField::passable(int x, int y) const {
+    if (x < 0 || y < 0 || x >= grid_.num_cols() || y >= grid_.num_rows()) {
+        return false;
+    }
+    return (x == goal_.x() && y == goal_.y()) || !grid_.filled(x, y);
+}
+
+/// Returns true if a diagonal step from (x,y) to (x+dx,y+dy) is allowed by the corner cutting rule.
+bool FlowField::diagonal_step_allowed(int x, int y, int dx, int dy) const {
+    bool horizontal_free = passable(x + dx, y);
+    bool vertical_free = passable(x, y + dy);
+    if (options_.allow_corner_cutting) {
+        return horizontal_free || vertical_free;
+    }
+    return horizontal_free && vertical_free;
+}
+
+/// Returns true if the step between the two (neighboring) cell ids is allowed.
+bool FlowField::step_allowed(int from_cell, int to_cell) const {
+    int num_cols = grid_.num_cols();
+    int x = from_cell % num_cols;
+    int y = from_cell / num_cols;
+    int step_x = to_cell % num_cols - x;
+    int step_y = to_cell / num_cols - y;
+    if (!passable(x + step_x, y + step_y)) {
+        return false;
+    }
+    return step_x == 0 || step_y == 0 || diagonal_step_allowed(x, y, step_x, step_y);
+}
+
+/// Returns the cell id to step to first from the specified cell, -1 if the goal can't be reached from it.
+/// A filled cell was never reached by the search, so its neighbors are looked at instead.
+int FlowField::first_step(const Node &from) const {
+    int num_cols = grid_.num_cols();
+    int from_cell = from.y() * num_cols + from.x();
+    if (cost_[from_cell] != -1) {
+        return next_[from_cell];
+    }
+
+    int num_directions = (options_.movement == PathingOptions::Movement::EightDirections) ? 8 : 4;
+    int best_cell = -1;
+    int best_cost = 0;
+    for (int i = 0; i < num_directions; i++) {
+        int nx = from.x() + dx[i];
+        int ny = from.y() + dy[i];
+        if (!passable(nx, ny) || cost_[ny * num_cols + nx] == -1) {
+            continue;
+        }
+        int step_cost = PathingOptions::straight_move_cost;
+        if (i >= 4) {
+            if (!diagonal_step_allowed(from.x(), from.y(), dx[i], dy[i])) {
+                continue;
+            }
+            step_cost = PathingOptions::diagonal_move_cost;
+        }
+        int total_cost = cost_[ny * num_cols + nx] + step_cost;
+        if (best_cell == -1 || total_cost < best_cost) {
+            best_cell = ny * num_cols + nx;
+            best_cost = total_cost;
+        }
+    }
+    return best_cell;
+}
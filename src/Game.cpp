@@ -22,6 +22,8 @@ Game::Game(MapGrid *map_grid, int x_pos_of_starting, int y_pos_of_starting) : ma
     /// register types that needed to be used in cross thread signal-slot stuff
     qRegisterMetaType<PathingMap>("PathingMap");
     qRegisterMetaType<PathingMap>("PathingMap&");
+    qRegisterMetaType<PathingOptions>("PathingOptions");
+    qRegisterMetaType<PathStatus>("PathStatus");
     qRegisterMetaType<std::vector<QPointF>>();
 
     for (Map *map : map_grid_->maps()) {
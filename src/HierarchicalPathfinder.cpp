@@ -0,0 +1,549 @@
+#include "HierarchicalPathfinder.h"
+
+using namespace cute;
+
+namespace {
+
+/// a stretch of border cells at most this long gets one transition (in its middle), longer ones get two
+const int max_single_transition_length = 6;
+
+const int dx[] = {0, 0, -1, 1};
+const int dy[] = {-1, 1, 0, 0};
+
+} // namespace
+
+HierarchicalPathfinder::HierarchicalPathfinder(int cluster_size) : cluster_size_(cluster_size) {
+    assert(cluster_size > 1);
+}
+
+int HierarchicalPathfinder::num_entrances() const {
+    int total = 0;
+    for (const Cluster &cluster : clusters_) {
+        total += cluster.entrances.size();
+    }
+    return total;
+}
+
+/// Brings the HierarchicalPathfinder up to date with the specified grid.
+///
+/// The first time (or if the size of the grid changed) everything is built. After that, only the clusters
+/// with cells that changed since the last update() (and their neighbors) are repaired.
+void HierarchicalPathfinder::update(const PathGrid &grid) {
+    if (clusters_.empty() || grid.num_cols() != num_cols_ || grid.num_rows() != num_rows_) {
+        grid_ = grid;
+        rebuild();
+        return;
+    }
+
+    /// find the clusters with changed cells, comparing 64 cells at a time
+    std::vector<bool> dirty(clusters_.size(), false);
+    bool any_dirty = false;
+    for (int y = 0; y < num_rows_; y++) {
+        for (int x = 0; x < num_cols_; x += 64) {
+            std::uint64_t changed = grid_.row_bits(y, x) ^ grid.row_bits(y, x);
+            while (changed) {
+                int changed_x = x + qCountTrailingZeroBits(changed);
+                int cluster_x = changed_x / cluster_size_;
+                dirty[(y / cluster_size_) * clusters_x_ + cluster_x] = true;
+                any_dirty = true;
+
+                /// the rest of this cluster's columns are covered already
+                int next_cluster_x = (cluster_x + 1) * cluster_size_ - x;
+                changed = (next_cluster_x >= 64) ? 0 : changed & (~std::uint64_t(0) << next_cluster_x);
+            }
+        }
+    }
+
+    num_repaired_clusters_ = 0;
+    if (!any_dirty) {
+        return;
+    }
+    grid_ = grid;
+    repair(dirty);
+}
+
+/// Returns a path from `from` to `to` (both included, every cell in between), going through cluster entrances.
+/// If `status` is given, it is set to how the search ended (see PathStatus).
+///
+/// Like PathGrid::shortest_path(), the start and end cells may be filled and an empty vector is returned if
+/// `from` == `to`, if either cell is outside the grid or if `to` can not be reached. Of the options, the budgets
+/// (every entrance expanded by the abstract search counts as an expansion), closest_reachable_fallback (the
+/// closest entrance reached) and smooth_path are used. The movement must be FourDirections and the agent_size 1.
+std::vector<Node> HierarchicalPathfinder::shortest_path(const Node &from, const Node &to,
+                                                        const PathingOptions &options, PathStatus *status) {
+    assert(options.movement == PathingOptions::Movement::FourDirections && options.agent_size <= 1);
+    PathStatus search_status = (from == to) ? PathStatus::Found : PathStatus::Unreachable;
+    if (status) {
+        *status = search_status;
+    }
+    if (from == to || !grid_.contains(from) || !grid_.contains(to)) {
+        return std::vector<Node>();
+    }
+
+    int from_cell = from.y() * num_cols_ + from.x();
+    int to_cell = to.y() * num_cols_ + to.x();
+
+    /// Edges of the abstract graph that only exist for this query (by the cell they leave from):
+    /// the start (and the unfilled cells next to it in other clusters, a filled start may step right
+    /// out of its cluster) connects to the entrances of its cluster, likewise for the end.
+    std::unordered_map<int, std::vector<std::pair<int, int>>> query_edges;
+    std::vector<int> start_cells = endpoint_cells(from_cell);
+    std::vector<int> end_cells = endpoint_cells(to_cell);
+    for (size_t i = 1; i < start_cells.size(); i++) {
+        query_edges[from_cell].push_back(std::make_pair(start_cells[i], 1));
+    }
+    for (size_t i = 1; i < end_cells.size(); i++) {
+        query_edges[end_cells[i]].push_back(std::make_pair(to_cell, 1));
+    }
+    if (abs(from.x() - to.x()) + abs(from.y() - to.y()) == 1) {
+        query_edges[from_cell].push_back(std::make_pair(to_cell, 1));
+    }
+    for (int start_cell : start_cells) {
+        int cluster = cluster_of(start_cell);
+        local_search(cluster, start_cell, to_cell);
+        for (int entrance : clusters_[cluster].entrances) {
+            int distance = local_distance(cluster, entrance);
+            if (distance > 0) {
+                query_edges[start_cell].push_back(std::make_pair(entrance, distance));
+            }
+        }
+        for (int end_cell : end_cells) {
+            int distance = (cluster_of(end_cell) == cluster) ? local_distance(cluster, end_cell) : -1;
+            if (distance > 0) {
+                query_edges[start_cell].push_back(std::make_pair(end_cell, distance));
+            }
+        }
+    }
+    for (int end_cell : end_cells) {
+        /// distances are the same both ways
+        int cluster = cluster_of(end_cell);
+        local_search(cluster, end_cell, -1);
+        for (int entrance : clusters_[cluster].entrances) {
+            int distance = local_distance(cluster, entrance);
+            if (distance > 0) {
+                query_edges[entrance].push_back(std::make_pair(end_cell, distance));
+            }
+        }
+    }
+
+    /// A* over the entrances, keyed by cell
+    std::unordered_map<int, SearchState> states;
+    std::vector<OpenEntry> open_nodes;
+    auto h_cost = [this, &to](int cell) { return abs(to.x() - cell % num_cols_) + abs(to.y() - cell / num_cols_); };
+    auto relax = [&](int cell, int parent, int g_cost) {
+        auto it = states.find(cell);
+        if (it != states.end() && (it->second.closed || g_cost >= it->second.g_cost)) {
+            return;
+        }
+        states[cell] = {g_cost, parent, false};
+        int cell_h_cost = h_cost(cell);
+        open_nodes.push_back({g_cost + cell_h_cost, cell_h_cost, g_cost, cell});
+        std::push_heap(open_nodes.begin(), open_nodes.end(), OpenEntryCompare());
+    };
+
+    std::chrono::steady_clock::time_point deadline;
+    if (options.max_milliseconds > 0) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.max_milliseconds);
+    }
+    int num_expanded = 0;
+    int closest_cell = from_cell;
+    int closest_h_cost = h_cost(from_cell);
+
+    relax(from_cell, -1, 0);
+    bool found = false;
+    bool budget_exceeded = false;
+    while (!open_nodes.empty()) {
+        std::pop_heap(open_nodes.begin(), open_nodes.end(), OpenEntryCompare());
+        OpenEntry current = open_nodes.back();
+        open_nodes.pop_back();
+
+        SearchState &state = states[current.cell];
+        if (state.closed || current.g_cost != state.g_cost) {
+            continue;
+        }
+
+        /// an expansion costs a whole row of the cluster's distances, so the clock is read every 16 of them
+        if ((options.max_expansions > 0 && num_expanded >= options.max_expansions) ||
+            (options.max_milliseconds > 0 && (num_expanded & 15) == 15 &&
+             std::chrono::steady_clock::now() >= deadline)) {
+            budget_exceeded = true;
+            break;
+        }
+        state.closed = true;
+        num_expanded++;
+        if (current.h_cost < closest_h_cost) {
+            closest_cell = current.cell;
+            closest_h_cost = current.h_cost;
+        }
+
+        if (current.cell == to_cell) {
+            found = true;
+            break;
+        }
+
+        auto query_edges_it = query_edges.find(current.cell);
+        if (query_edges_it != query_edges.end()) {
+            for (const std::pair<int, int> &edge : query_edges_it->second) {
+                relax(edge.first, current.cell, current.g_cost + edge.second);
+            }
+        }
+
+        int cluster_index = cluster_of(current.cell);
+        int i = entrance_index(cluster_index, current.cell);
+        if (i == -1) {
+            continue;
+        }
+
+        /// to the other entrances of the same cluster
+        const Cluster &cluster = clusters_[cluster_index];
+        int num_entrances = cluster.entrances.size();
+        for (int j = 0; j < num_entrances; j++) {
+            int distance = cluster.distances[i * num_entrances + j];
+            if (j != i && distance >= 0) {
+                relax(cluster.entrances[j], current.cell, current.g_cost + distance);
+            }
+        }
+
+        /// over the borders of the cluster
+        for (int crossing : cluster.crossings[i]) {
+            relax(crossing, current.cell, current.g_cost + 1);
+        }
+    }
+
+    int end_cell = to_cell;
+    if (!found) {
+        search_status = budget_exceeded ? PathStatus::BudgetExceeded : PathStatus::Unreachable;
+        if (!options.closest_reachable_fallback || closest_cell == from_cell) {
+            if (status) {
+                *status = search_status;
+            }
+            return std::vector<Node>();
+        }
+        if (search_status == PathStatus::Unreachable) {
+            search_status = PathStatus::Partial;
+        }
+        end_cell = closest_cell;
+    } else {
+        search_status = PathStatus::Found;
+    }
+    if (status) {
+        *status = search_status;
+    }
+
+    std::vector<int> abstract_path;
+    for (int cell = end_cell; cell != -1; cell = states[cell].parent) {
+        abstract_path.push_back(cell);
+    }
+    std::reverse(abstract_path.begin(), abstract_path.end());
+
+    /// refine: steps over a border are single moves, everything else stays inside one cluster
+    std::vector<Node> path;
+    path.push_back(from);
+    for (size_t k = 0; k + 1 < abstract_path.size(); k++) {
+        int a = abstract_path[k];
+        int b = abstract_path[k + 1];
+        if (cluster_of(a) != cluster_of(b)) {
+            assert(abs(a % num_cols_ - b % num_cols_) + abs(a / num_cols_ - b / num_cols_) == 1);
+            path.push_back(Node(b % num_cols_, b / num_cols_));
+        } else {
+            append_local_path(cluster_of(a), a, b, path);
+        }
+    }
+    if (options.smooth_path) {
+        return grid_.smooth_path(path);
+    }
+    return path;
+}
+
+int HierarchicalPathfinder::cluster_of(int cell) const {
+    return (cell / num_cols_ / cluster_size_) * clusters_x_ + (cell % num_cols_) / cluster_size_;
+}
+
+/// Gets the cells (inclusive) covered by the specified cluster. Clusters on the right/bottom edge may be smaller.
+void HierarchicalPathfinder::cluster_bounds(int cluster, int &x0, int &y0, int &x1, int &y1) const {
+    x0 = (cluster % clusters_x_) * cluster_size_;
+    y0 = (cluster / clusters_x_) * cluster_size_;
+    x1 = std::min(x0 + cluster_size_, num_cols_) - 1;
+    y1 = std::min(y0 + cluster_size_, num_rows_) - 1;
+}
+
+/// Returns the specified cell followed by its unfilled neighbors that are in other clusters.
+std::vector<int> HierarchicalPathfinder::endpoint_cells(int cell) const {
+    std::vector<int> cells;
+    cells.push_back(cell);
+    int x = cell % num_cols_;
+    int y = cell / num_cols_;
+    for (int i = 0; i < 4; i++) {
+        int nx = x + dx[i];
+        int ny = y + dy[i];
+        if (nx < 0 || ny < 0 || nx >= num_cols_ || ny >= num_rows_ || grid_.filled(nx, ny)) {
+            continue;
+        }
+        int neighbor = ny * num_cols_ + nx;
+        if (cluster_of(neighbor) != cluster_of(cell)) {
+            cells.push_back(neighbor);
+        }
+    }
+    return cells;
+}
+
+/// Returns the index of the specified cell in the entrances of the cluster, -1 if it is not an entrance.
+int HierarchicalPathfinder::entrance_index(int cluster, int cell) const {
+    const std::vector<int> &entrances = clusters_[cluster].entrances;
+    auto it = std::lower_bound(entrances.begin(), entrances.end(), cell);
+    if (it == entrances.end() || *it != cell) {
+        return -1;
+    }
+    return it - entrances.begin();
+}
+
+/// Builds all borders and clusters from scratch.
+void HierarchicalPathfinder::rebuild() {
+    num_cols_ = grid_.num_cols();
+    num_rows_ = grid_.num_rows();
+    clusters_x_ = (num_cols_ + cluster_size_ - 1) / cluster_size_;
+    clusters_y_ = (num_rows_ + cluster_size_ - 1) / cluster_size_;
+
+    int num_clusters = clusters_x_ * clusters_y_;
+    clusters_.assign(num_clusters, Cluster());
+    east_transitions_.assign(num_clusters, std::vector<Transition>());
+    south_transitions_.assign(num_clusters, std::vector<Transition>());
+
+    for (int cluster = 0; cluster < num_clusters; cluster++) {
+        build_borders(cluster);
+    }
+    for (int cluster = 0; cluster < num_clusters; cluster++) {
+        build_cluster(cluster);
+    }
+    num_repaired_clusters_ = num_clusters;
+}
+
+/// Recomputes the borders of the dirty clusters, then the entrances of every cluster touching such a border.
+void HierarchicalPathfinder::repair(const std::vector<bool> &dirty) {
+    int num_clusters = clusters_.size();
+    std::vector<bool> affected(num_clusters, false);
+    for (int cluster = 0; cluster < num_clusters; cluster++) {
+        if (!dirty[cluster]) {
+            continue;
+        }
+        int cluster_x = cluster % clusters_x_;
+        int cluster_y = cluster / clusters_x_;
+
+        /// the west and north borders belong to the neighbors
+        build_borders(cluster);
+        if (cluster_x > 0) {
+            build_borders(cluster - 1);
+        }
+        if (cluster_y > 0) {
+            build_borders(cluster - clusters_x_);
+        }
+
+        affected[cluster] = true;
+        for (int i = 0; i < 4; i++) {
+            int neighbor_x = cluster_x + dx[i];
+            int neighbor_y = cluster_y + dy[i];
+            if (neighbor_x >= 0 && neighbor_y >= 0 && neighbor_x < clusters_x_ && neighbor_y < clusters_y_) {
+                affected[neighbor_y * clusters_x_ + neighbor_x] = true;
+            }
+        }
+    }
+
+    for (int cluster = 0; cluster < num_clusters; cluster++) {
+        if (affected[cluster]) {
+            build_cluster(cluster);
+            num_repaired_clusters_++;
+        }
+    }
+}
+
+/// Recomputes the transitions over the east and south border of the specified cluster.
+void HierarchicalPathfinder::build_borders(int cluster) {
+    int x0, y0, x1, y1;
+    cluster_bounds(cluster, x0, y0, x1, y1);
+
+    east_transitions_[cluster].clear();
+    if (x1 + 1 < num_cols_) {
+        build_border(x1, y0, 1, 0, 0, 1, y1 - y0 + 1, east_transitions_[cluster]);
+    }
+    south_transitions_[cluster].clear();
+    if (y1 + 1 < num_rows_) {
+        build_border(x0, y1, 0, 1, 1, 0, x1 - x0 + 1, south_transitions_[cluster]);
+    }
+}
+
+/// Finds the stretches along a border where the cells on both sides are unfilled and adds transitions for them.
+///
+/// The `i`th cell on the inside of the border is (inside_x + i * along_x, inside_y + i * along_y), the cell
+/// across the border from it is (step_x, step_y) further.
+void HierarchicalPathfinder::build_border(int inside_x, int inside_y, int step_x, int step_y, int along_x,
+                                          int along_y, int length, std::vector<Transition> &transitions) {
+    auto open = [&](int i) {
+        int x = inside_x + i * along_x;
+        int y = inside_y + i * along_y;
+        return !grid_.filled(x, y) && !grid_.filled(x + step_x, y + step_y);
+    };
+    auto add_transition = [&](int i) {
+        int x = inside_x + i * along_x;
+        int y = inside_y + i * along_y;
+        transitions.push_back({y * num_cols_ + x, (y + step_y) * num_cols_ + (x + step_x)});
+    };
+
+    int i = 0;
+    while (i < length) {
+        if (!open(i)) {
+            i++;
+            continue;
+        }
+        int first = i;
+        while (i < length && open(i)) {
+            i++;
+        }
+        int last = i - 1;
+        if (last - first + 1 <= max_single_transition_length) {
+            add_transition((first + last) / 2);
+        } else {
+            add_transition(first);
+            add_transition(last);
+        }
+    }
+}
+
+/// Collects the entrances of the specified cluster (from the transitions of its 4 borders)
+/// and computes the distances between them.
+void HierarchicalPathfinder::build_cluster(int cluster) {
+    int cluster_x = cluster % clusters_x_;
+    int cluster_y = cluster / clusters_x_;
+
+    std::vector<int> entrances;
+    for (const Transition &transition : east_transitions_[cluster]) {
+        entrances.push_back(transition.inside);
+    }
+    for (const Transition &transition : south_transitions_[cluster]) {
+        entrances.push_back(transition.inside);
+    }
+    if (cluster_x > 0) {
+        for (const Transition &transition : east_transitions_[cluster - 1]) {
+            entrances.push_back(transition.outside);
+        }
+    }
+    if (cluster_y > 0) {
+        for (const Transition &transition : south_transitions_[cluster - clusters_x_]) {
+            entrances.push_back(transition.outside);
+        }
+    }
+    std::sort(entrances.begin(), entrances.end());
+    entrances.erase(std::unique(entrances.begin(), entrances.end()), entrances.end());
+
+    /// index the border crossings by entrance, so the abstract search finds them without scanning the borders
+    std::vector<std::vector<int>> crossings(entrances.size());
+    auto add_crossing = [&](int entrance, int crossing) {
+        crossings[std::lower_bound(entrances.begin(), entrances.end(), entrance) - entrances.begin()].push_back(
+                crossing);
+    };
+    for (const Transition &transition : east_transitions_[cluster]) {
+        add_crossing(transition.inside, transition.outside);
+    }
+    for (const Transition &transition : south_transitions_[cluster]) {
+        add_crossing(transition.inside, transition.outside);
+    }
+    if (cluster_x > 0) {
+        for (const Transition &transition : east_transitions_[cluster - 1]) {
+            add_crossing(transition.outside, transition.inside);
+        }
+    }
+    if (cluster_y > 0) {
+        for (const Transition &transition : south_transitions_[cluster - clusters_x_]) {
+            add_crossing(transition.outside, transition.inside);
+        }
+    }
+
+    int num_entrances = entrances.size();
+    std::vector<int> distances(num_entrances * num_entrances, -1);
+    for (int i = 0; i < num_entrances; i++) {
+        local_search(cluster, entrances[i], -1);
+        for (int j = 0; j < num_entrances; j++) {
+            distances[i * num_entrances + j] = local_distance(cluster, entrances[j]);
+        }
+    }
+
+    clusters_[cluster].entrances = std::move(entrances);
+    clusters_[cluster].distances = std::move(distances);
+    clusters_[cluster].crossings = std::move(crossings);
+}
+
+/// Breadth first search from `origin` that does not leave the specified cluster.
+///
+/// Fills in local_distance_ (-1 for cells that can't be reached) and local_parent_.
+/// The origin and `target` cells may be filled, a filled `target` is reached but not moved through.
+/// If `stop_at_target` is true, the search ends as soon as `target` is reached (other distances are incomplete).
+void HierarchicalPathfinder::local_search(int cluster, int origin, int target, bool stop_at_target) {
+    int x0, y0, x1, y1;
+    cluster_bounds(cluster, x0, y0, x1, y1);
+    int width = x1 - x0 + 1;
+    int height = y1 - y0 + 1;
+
+    local_distance_.assign(width * height, -1);
+    local_parent_.resize(width * height);
+    local_queue_.clear();
+
+    int origin_local = (origin / num_cols_ - y0) * width + (origin % num_cols_ - x0);
+    local_distance_[origin_local] = 0;
+    local_parent_[origin_local] = -1;
+    local_queue_.push_back(origin_local);
+
+    for (size_t head = 0; head < local_queue_.size(); head++) {
+        int current = local_queue_[head];
+        int x = x0 + current % width;
+        int y = y0 + current / width;
+        if (current != origin_local && grid_.filled(x, y)) {
+            continue;
+        }
+        for (int i = 0; i < 4; i++) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (nx < x0 || ny < y0 || nx > x1 || ny > y1) {
+                continue;
+            }
+            int neighbor = (ny - y0) * width + (nx - x0);
+            if (local_distance_[neighbor] != -1) {
+                continue;
+            }
+            if (grid_.filled(nx, ny) && ny * num_cols_ + nx != target) {
+                continue;
+            }
+            local_distance_[neighbor] = local_distance_[current] + 1;
+            local_parent_[neighbor] = current;
+            local_queue_.push_back(neighbor);
+            if (stop_at_target && ny * num_cols_ + nx == target) {
+                return;
+            }
+        }
+    }
+}
+
+/// Returns the distance the last local_search() (which must have been in the same cluster) found to the cell.
+int HierarchicalPathfinder::local_distance(int cluster, int cell) const {
+    int x0, y0, x1, y1;
+    cluster_bounds(cluster, x0, y0, x1, y1);
+    return local_distance_[(cell / num_cols_ - y0) * (x1 - x0 + 1) + (cell % num_cols_ - x0)];
+}
+
+/// Appends the cells of a shortest path from `from` to `to` (which must be connected within the specified
+/// cluster) to the path, `from` itself is not appended.
+void HierarchicalPathfinder::append_local_path(int cluster, int from, int to, std::vector<Node> &path) {
+    local_search(cluster, from, to, true);
+
+    int x0, y0, x1, y1;
+    cluster_bounds(cluster, x0, y0, x1, y1);
+    int width = x1 - x0 + 1;
+
+    int current = (to / num_cols_ - y0) * width + (to % num_cols_ - x0);
+    assert(local_distance_[current] != -1);
+
+    size_t first = path.size();
+    while (local_parent_[current] != -1) {
+        path.push_back(Node(x0 + current % width, y0 + current / width));
+        current = local_parent_[current];
+    }
+    std::reverse(path.begin() + first, path.end());
+}
@@ -0,0 +1,275 @@
+#include "IncrementalPathPlanner.h"
+
+using namespace cute;
+
+namespace {
+
+/// up, down, left, right, then the diagonals
+const int dx[] = {0, 0, -1, 1, -1, 1, -1, 1};
+const int dy[] = {-1, 1, 0, 0, -1, -1, 1, 1};
+
+/// the cost of a cell the root can't be reached from (or of a move that is not possible)
+const int infinite_cost = std::numeric_limits<int>::max() / 4;
+
+int add_costs(int a, int b) { return (a >= infinite_cost || b >= infinite_cost) ? infinite_cost : a + b; }
+
+} // namespace
+
+IncrementalPathPlanner::IncrementalPathPlanner(const PathingOptions &options) : options_(options) {}
+
+/// Forgets the previous search, the next shortest_path() starts over.
+void IncrementalPathPlanner::reset() {
+    searching_ = false;
+    rooted_at_from_ = false;
+    grid_ = PathGrid();
+}
+
+/// Returns the shortest path from `from` to `to` (both included, every cell in between) in the specified grid.
+///
+/// Like PathGrid::shortest_path(), the start and end cells may be filled and an empty vector is returned if
+/// `from` == `to`, if either cell is outside the grid or if `to` can not be reached.
+/// If one end of the path is where the previous call had it, the previous search is repaired instead of repeated.
+/// If `status` is given, it is set to how the search ended (Found, Unreachable or BudgetExceeded).
+std::vector<Node> IncrementalPathPlanner::shortest_path(const PathGrid &grid, const Node &from, const Node &to,
+                                                        PathStatus *status) {
+    num_expanded_ = 0;
+    num_changed_cells_ = 0;
+    if (from == to || !grid.contains(from) || !grid.contains(to)) {
+        if (status) {
+            *status = (from == to) ? PathStatus::Found : PathStatus::Unreachable;
+        }
+        return std::vector<Node>();
+    }
+
+    int from_cell = from.y() * grid.num_cols() + from.x();
+    int to_cell = to.y() * grid.num_cols() + to.x();
+    bool same_grid = searching_ && grid.num_cols() == num_cols_ && grid.num_rows() == num_rows_;
+    int root_cell = rooted_at_from_ ? from_cell : to_cell;
+    if (!same_grid || root_cell != goal_cell_) {
+        /// the end the search was rooted at moved, root the new search at the end that stayed put (if any):
+        /// that is the one most likely to stay put next time as well
+        if (same_grid) {
+            int previous_from_cell = rooted_at_from_ ? goal_cell_ : start_cell_;
+            int previous_to_cell = rooted_at_from_ ? start_cell_ : goal_cell_;
+            if (from_cell == previous_from_cell) {
+                rooted_at_from_ = true;
+            } else if (to_cell == previous_to_cell) {
+                rooted_at_from_ = false;
+            }
+        }
+        begin_search(grid, rooted_at_from_ ? to_cell : from_cell, rooted_at_from_ ? from_cell : to_cell);
+    } else {
+        /// the other end moved: keys of cells already in the open list are now too high by up to this much
+        int moving_cell = rooted_at_from_ ? to_cell : from_cell;
+        key_modifier_ += distance(start_cell_, moving_cell);
+        start_cell_ = moving_cell;
+
+        /// a changed cell changes the cost of the moves into it and (for diagonal moves) past it,
+        /// all of which start in the cell itself or one of its neighbors
+        std::vector<Node> changed_cells = grid_.changed_cells(grid);
+        num_changed_cells_ = changed_cells.size();
+        grid_ = grid;
+        for (const Node &cell : changed_cells) {
+            update_cell(cell.y() * num_cols_ + cell.x());
+            for (int i = 0; i < 8; i++) {
+                int nx = cell.x() + dx[i];
+                int ny = cell.y() + dy[i];
+                if (nx >= 0 && ny >= 0 && nx < num_cols_ && ny < num_rows_) {
+                    update_cell(ny * num_cols_ + nx);
+                }
+            }
+        }
+    }
+
+    if (!compute_shortest_path()) {
+        if (status) {
+            *status = PathStatus::BudgetExceeded;
+        }
+        return std::vector<Node>();
+    }
+    std::vector<Node> path = build_path();
+    if (status) {
+        *status = path.empty() ? PathStatus::Unreachable : PathStatus::Found;
+    }
+    /// moves cost the same both ways (only the cell moved to counts and the ends may both be filled),
+    /// so a path walked from `to` back to `from` is a shortest path from `from` to `to` as well
+    if (rooted_at_from_) {
+        std::reverse(path.begin(), path.end());
+    }
+    return path;
+}
+
+/// Starts a new search rooted at `root_cell`, every cell starts out with an infinite cost except the root.
+/// The search is then repaired as `start_cell` (the other end of the path) moves.
+void IncrementalPathPlanner::begin_search(const PathGrid &grid, int start_cell, int root_cell) {
+    grid_ = grid;
+    searching_ = true;
+    num_cols_ = grid.num_cols();
+    num_rows_ = grid.num_rows();
+    goal_cell_ = root_cell;
+    start_cell_ = start_cell;
+    key_modifier_ = 0;
+
+    int num_cells = num_cols_ * num_rows_;
+    g_.assign(num_cells, infinite_cost);
+    rhs_.assign(num_cells, infinite_cost);
+    open_cells_.reset(num_cells);
+
+    rhs_[goal_cell_] = 0;
+    open_cells_.update(goal_cell_, key(goal_cell_));
+}
+
+/// Expands cells until the cost of the start is final.
+/// Returns false if the budget of the options ran out first, the open list then holds the cells left to expand.
+bool IncrementalPathPlanner::compute_shortest_path() {
+    std::chrono::steady_clock::time_point deadline;
+    if (options_.max_milliseconds > 0) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.max_milliseconds);
+    }
+
+    while (!open_cells_.empty() &&
+           (open_cells_.top_priority() < key(start_cell_) || rhs_[start_cell_] > g_[start_cell_])) {
+        if (options_.max_expansions > 0 && num_expanded_ >= options_.max_expansions) {
+            return false;
+        }
+        /// reading the clock is not free, so the time budget is only checked every 64 expansions
+        if (options_.max_milliseconds > 0 && (num_expanded_ & 63) == 63 &&
+            std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+
+        int cell = open_cells_.top();
+        Key old_key = open_cells_.top_priority();
+        Key new_key = key(cell);
+        if (old_key < new_key) {
+            /// the key is outdated (the start moved since it was queued)
+            open_cells_.update(cell, new_key);
+            continue;
+        }
+
+        open_cells_.pop();
+        num_expanded_++;
+        if (g_[cell] > rhs_[cell]) {
+            g_[cell] = rhs_[cell];
+        } else {
+            g_[cell] = infinite_cost;
+            update_cell(cell);
+        }
+
+        int x = cell % num_cols_;
+        int y = cell / num_cols_;
+        for (int i = 0; i < 8; i++) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (nx >= 0 && ny >= 0 && nx < num_cols_ && ny < num_rows_) {
+                update_cell(ny * num_cols_ + nx);
+            }
+        }
+    }
+    return true;
+}
+
+/// Recomputes the rhs of the specified cell from its neighbors and (re)queues it if it is inconsistent.
+void IncrementalPathPlanner::update_cell(int cell) {
+    if (cell != goal_cell_) {
+        int num_directions = (options_.movement == PathingOptions::Movement::EightDirections) ? 8 : 4;
+        int best = infinite_cost;
+        for (int i = 0; i < num_directions; i++) {
+            int cost = step_cost(cell, i);
+            if (cost < infinite_cost) {
+                int neighbor = (cell / num_cols_ + dy[i]) * num_cols_ + cell % num_cols_ + dx[i];
+                best = std::min(best, add_costs(cost, g_[neighbor]));
+            }
+        }
+        rhs_[cell] = best;
+    }
+
+    if (g_[cell] != rhs_[cell]) {
+        open_cells_.update(cell, key(cell));
+    } else {
+        open_cells_.remove(cell);
+    }
+}
+
+/// Orders the open list: lowest estimated total cost first, then lowest cost to the root.
+IncrementalPathPlanner::Key IncrementalPathPlanner::key(int cell) const {
+    int cost = std::min(g_[cell], rhs_[cell]);
+    return Key(add_costs(add_costs(cost, distance(start_cell_, cell)), key_modifier_), cost);
+}
+
+/// A cell can be walked on if it is in the grid and unfilled. The root cell can always be walked on.
+bool IncrementalPathPlanner::passable(int x, int y) const {
+    if (x < 0 || y < 0 || x >= num_cols_ || y >= num_rows_) {
+        return false;
+    }
+    return y * num_cols_ + x == goal_cell_ || !grid_.filled(x, y);
+}
+
+/// Returns the cost of moving from the specified cell one step in the specified direction (an index into dx/dy),
+/// infinite_cost if the move is not possible. Only the cell moved to (and for diagonal moves, the corner rule)
+/// matters, so the start can move off a filled cell.
+int IncrementalPathPlanner::step_cost(int from_cell, int direction) const {
+    int x = from_cell % num_cols_;
+    int y = from_cell / num_cols_;
+    if (!passable(x + dx[direction], y + dy[direction])) {
+        return infinite_cost;
+    }
+    if (direction < 4) {
+        return PathingOptions::straight_move_cost;
+    }
+
+    bool horizontal_free = passable(x + dx[direction], y);
+    bool vertical_free = passable(x, y + dy[direction]);
+    bool allowed = options_.allow_corner_cutting ? (horizontal_free || vertical_free)
+                                                 : (horizontal_free && vertical_free);
+    return allowed ? PathingOptions::diagonal_move_cost : infinite_cost;
+}
+
+/// Returns the cost of the cheapest path between the cells if there were no obstacles (the heuristic).
+int IncrementalPathPlanner::distance(int cell0, int cell1) const {
+    int distance_x = abs(cell0 % num_cols_ - cell1 % num_cols_);
+    int distance_y = abs(cell0 / num_cols_ - cell1 / num_cols_);
+    if (options_.movement == PathingOptions::Movement::FourDirections) {
+        return PathingOptions::straight_move_cost * (distance_x + distance_y);
+    }
+    int diagonal_steps = std::min(distance_x, distance_y);
+    int straight_steps = std::max(distance_x, distance_y) - diagonal_steps;
+    return PathingOptions::diagonal_move_cost * diagonal_steps + PathingOptions::straight_move_cost * straight_steps;
+}
+
+/// Walks from the start to the root, always stepping to the neighbor with the lowest cost (move + its g).
+std::vector<Node> IncrementalPathPlanner::build_path() const {
+    /// the start itself may not have been expanded, but its rhs is final
+    std::vector<Node> path;
+    if (rhs_[start_cell_] >= infinite_cost) {
+        return path;
+    }
+
+    int num_directions = (options_.movement == PathingOptions::Movement::EightDirections) ? 8 : 4;
+    int cell = start_cell_;
+    path.push_back(Node(cell % num_cols_, cell / num_cols_));
+    while (cell != goal_cell_) {
+        int next = -1;
+        int best = infinite_cost;
+        for (int i = 0; i < num_directions; i++) {
+            int cost = step_cost(cell, i);
+            if (cost >= infinite_cost) {
+                continue;
+            }
+            int neighbor = (cell / num_cols_ + dy[i]) * num_cols_ + cell % num_cols_ + dx[i];
+            int total = add_costs(cost, g_[neighbor]);
+            if (total < best) {
+                best = total;
+                next = neighbor;
+            }
+        }
+
+        /// can't happen once the search is consistent, but never loop forever
+        if (next == -1 || static_cast<int>(path.size()) > num_cols_ * num_rows_) {
+            return std::vector<Node>();
+        }
+        cell = next;
+        path.push_back(Node(cell % num_cols_, cell / num_cols_));
+    }
+    return path;
+}
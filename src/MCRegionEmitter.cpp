@@ -1,6 +1,7 @@
 #include "MCRegionEmitter.h"
 #include "Entity.h"
 #include "Map.h"
+#include "QtUtilities.h"
 #include "stl_helper.h"
 
 using namespace cute;
@@ -26,7 +27,7 @@ void MCRegionEmitter::set_on_entity_left_callback(const std::function<void(MCReg
 }
 
 bool MCRegionEmitter::intersects_with_entity(Entity *entity) {
-    return entity->bounding_polygon_in_map().intersects(region_);
+    return QtUtils::intersects(entity->bounding_polygon_in_map(), region_);
 }
 
 void MCRegionEmitter::on_entity_moved(Map *sender, Entity *entity) {
@@ -4,6 +4,7 @@
 #include "GUI.h"
 #include "Game.h"
 #include "PositionalSound.h"
+#include "QtUtilities.h"
 #include "Sound.h"
 #include "Sprite.h"
 #include "TerrainLayer.h"
@@ -27,6 +28,7 @@ Map::Map(PathingMap *pathing_map) : own_pathing_map_(pathing_map) {
     gui_layer_ = new QGraphicsRectItem();
     weather_layer_ = new QGraphicsRectItem();
     overall_pathing_map_ = new PathingMap(num_cells_wide_, num_cells_long_, cell_size_);
+    occupancy_.assign(num_cells_wide_ * num_cells_long_, 0);
     scene_ = new QGraphicsScene(this);
 
     /// add layers in proper order
@@ -61,100 +63,366 @@ QPointF Map::get_mouse_position() {
     return game()->get_mouse_pos_in_map();
 }
 
-void Map::add_pathing_map(PathingMap &pm, const QPointF &at_pos) {
-    stl_helper::add(additional_pathing_map_, &pm, at_pos);
+/// Returns the merged PathingMap of the Map and its Entities, with every pending change applied
+/// (see update_pathing_map()).
+PathingMap &Map::pathing_map() {
+    if (pathing_update_pending_) {
+        flush_pathing_updates();
+    }
+    return *overall_pathing_map_;
 }
 
-void Map::remove_pathing_map(PathingMap &pm) { stl_helper::remove(additional_pathing_map_, &pm); }
+/// Adds the filled cells of the specified PathingMap (placed at the specified position) to pathing_map().
+/// Only the occupancy of the covered cells changes, pathing_map() itself is brought up to date by
+/// update_pathing_map(). Adding a PathingMap that was already added moves it.
+void Map::add_pathing_map(PathingMap &pm, const QPointF &at_pos) {
+    remove_pathing_map(pm);
 
-/// merge each additional pathing map to own pathing map.
-void Map::update_pathing_map() {
-    delete overall_pathing_map_;
-    overall_pathing_map_ = new PathingMap(num_cells_wide_, num_cells_long_, cell_size_);
-    overall_pathing_map_->add_filling(*own_pathing_map_, QPointF(0, 0));
+    AddedPathingMap added{at_pos, pm.version(), overall_pathing_map_->footprint(pm, at_pos)};
+    change_occupancy(added.footprint, 1);
+    stl_helper::add(additional_pathing_maps_, &pm, added);
+}
 
-    for (auto &pm_pos : additional_pathing_map_) {
-        overall_pathing_map_->add_filling(*pm_pos.first, pm_pos.second);
+void Map::remove_pathing_map(PathingMap &pm) {
+    auto added = additional_pathing_maps_.find(&pm);
+    if (added == additional_pathing_maps_.end()) {
+        return;
     }
+    change_occupancy(added->second.footprint, -1);
+    additional_pathing_maps_.erase(added);
+}
 
-    /// the following invocations are for debugging
-    draw_pathing_map();
-    draw_entity_pathing_map_bounds();
-    draw_entity_bounding_boxes();
+/// Returns true if the cell of the specified point is free, not counting the filled cells of the specified
+/// additional pathing map (e.g. an Entity's own PathingMap, when checking where the Entity itself can go).
+/// Returns false if the point is outside of the Map.
+///
+/// Like can_fit(), this reads the occupancy counts directly, so it never modifies or merges pathing_map().
+bool Map::free(const QPointF &point, const PathingMap *ignoring) {
+    Node cell = overall_pathing_map_->point_to_cell(point);
+    if (!overall_pathing_map_->path_grid().contains(cell)) {
+        return false;
+    }
+    return cells_free({cell}, ignoring);
 }
 
-int Map::width() const { return own_pathing_map_->width(); }
+/// Returns true if the specified PathingMap can be added at the specified position without any of its filled
+/// cells landing on a filled cell, not counting the filled cells of the additional pathing map `ignoring`.
+/// Filled cells that would land outside of the Map are not checked (add_pathing_map() leaves them out too).
+bool Map::can_fit(const PathingMap &pm, const QPointF &at_pos, const PathingMap *ignoring) {
+    return cells_free(overall_pathing_map_->footprint(pm, at_pos), ignoring);
+}
 
-int Map::height() const { return own_pathing_map_->height(); }
+/// Returns true if none of the specified cells (which must be in the Map) is filled in own_pathing_map_ or
+/// covered by an additional pathing map other than `ignoring`. Costs as much as the cells and the footprint of
+/// `ignoring`, whatever the size of the Map.
+bool Map::cells_free(const std::vector<Node> &cells, const PathingMap *ignoring) {
+    std::unordered_map<Node, int> ignored = ignored_occupancy(ignoring);
+    for (const Node &cell : cells) {
+        if (own_pathing_map_->filled(cell)) {
+            return false;
+        }
+        int occupancy = occupancy_[cell.y() * num_cells_wide_ + cell.x()];
+        auto ignored_cell = ignored.find(cell);
+        if (ignored_cell != ignored.end()) {
+            occupancy -= ignored_cell->second;
+        }
+        if (occupancy > 0) {
+            return false;
+        }
+    }
+    return true;
+}
 
-QSizeF Map::size() const { return QSizeF(width(), height()); }
+/// Returns how many times the footprint of the specified additional pathing map covers each of its cells
+/// (empty if it was not added).
+std::unordered_map<Node, int> Map::ignored_occupancy(const PathingMap *ignoring) {
+    std::unordered_map<Node, int> occupancy;
+    auto ignored = additional_pathing_maps_.find(ignoring);
+    if (ignored != additional_pathing_maps_.end()) {
+        for (const Node &cell : ignored->second.footprint) {
+            occupancy[cell]++;
+        }
+    }
+    return occupancy;
+}
 
-QPointF Map::cell_to_point(const Node &cell) { return pathing_map().cell_to_point(cell); }
+/// Moves the Entity (and its children, which move along with it) to its current bounds in entity_hash_.
+/// Entities call this whenever their bounds in the Map may have changed.
+void Map::update_entity_bounds(Entity *entity) {
+    if (!contains(entity)) {
+        return;
+    }
+    entity_hash_.update(entity, entity->bounding_polygon_in_map().boundingRect());
+    for (Entity *child : entity->children()) {
+        update_entity_bounds(child);
+    }
+}
 
-Node Map::point_to_cell(const QPointF &point) { return pathing_map().point_to_cell(point); }
+/// Counts the specified cells as covered by one more (or one less) additional pathing map.
+void Map::change_occupancy(const std::vector<Node> &footprint, int delta) {
+    for (const Node &cell : footprint) {
+        occupancy_[cell.y() * num_cells_wide_ + cell.x()] += delta;
+        dirty_cells_.push_back(cell);
+        dirty_rect_ |= QRect(cell.x(), cell.y(), 1, 1);
+    }
+}
 
-void Map::remove_and_clear_debugging_polygons(std::vector<QGraphicsPolygonItem *> &polygons) {
-    for (QGraphicsPolygonItem *p : polygons) {
-        scene_->removeItem(p);
-        delete p;
+/// Asks for pathing_map() to be brought up to date with the added/removed pathing maps (and own_pathing_map_).
+///
+/// The changes are not applied right away: all the changes made until control returns to the event loop
+/// (e.g. every Entity moved by the same timer tick) are applied together, by flush_pathing_updates(), either at
+/// the end of the current event loop iteration or before pathing_map() is read, whichever comes first.
+/// So AI and path searches always see the current pathing, but Entities moving back and forth cost nothing.
+void Map::update_pathing_map() {
+    if (pathing_update_pending_) {
+        return;
     }
-    polygons.clear();
+    pathing_update_pending_ = true;
+    QTimer::singleShot(0, this, [this]() { flush_pathing_updates(); });
 }
 
-void Map::draw_pathing_map() {
-    remove_and_clear_debugging_polygons(debugging_pathing_map_rects_);
-    for (Node cell : pathing_map().cells()) {
-        if (pathing_map().filled(cell)) {
-            debugging_pathing_map_rects_.push_back(draw_filled_cell(cell));
+/// Applies the changes asked for by update_pathing_map() now (does nothing if there are none).
+///
+/// Only the cells whose occupancy changed since the last flush are looked at, so moving an Entity costs as much
+/// as the size of its PathingMap, not the size of the Map. The whole Map is merged again only when
+/// own_pathing_map_ changed. All the changed cells are applied together, so a flush moves pathing_map() to a
+/// single new version, and it keeps its version if no cell changed, so cached paths stay valid.
+void Map::flush_pathing_updates() {
+    if (!pathing_update_pending_) {
+        return;
+    }
+    pathing_update_pending_ = false;
+
+    /// additional pathing maps that were filled/unfilled after being added cover different cells now
+    for (auto &pm_added : additional_pathing_maps_) {
+        AddedPathingMap &added = pm_added.second;
+        if (pm_added.first->version() != added.version) {
+            change_occupancy(added.footprint, -1);
+            added.version = pm_added.first->version();
+            added.footprint = overall_pathing_map_->footprint(*pm_added.first, added.pos);
+            change_occupancy(added.footprint, 1);
+        }
+    }
+
+    bool changed = false;
+    bool merged_all = own_pathing_map_->version() != merged_own_version_;
+    std::vector<Node> changed_cells;
+    if (merged_all) {
+        std::vector<Node> occupied_cells;
+        for (int y = 0; y < num_cells_long_; y++) {
+            for (int x = 0; x < num_cells_wide_; x++) {
+                if (occupancy_[y * num_cells_wide_ + x] > 0) {
+                    occupied_cells.push_back(Node(x, y));
+                }
+            }
+        }
+        PathingMap updated_pathing_map(num_cells_wide_, num_cells_long_, cell_size_);
+        updated_pathing_map.add_filling(*own_pathing_map_, QPointF(0, 0));
+        updated_pathing_map.change_filling(occupied_cells, {});
+        if (updated_pathing_map.path_grid() != overall_pathing_map_->path_grid()) {
+            *overall_pathing_map_ = updated_pathing_map;
+            changed = true;
+        }
+        merged_own_version_ = own_pathing_map_->version();
+    } else {
+        /// cells moved over several times since the last flush are in dirty_cells_ several times,
+        /// go over the dirty rect instead if it has fewer cells
+        if (static_cast<int>(dirty_cells_.size()) > dirty_rect_.width() * dirty_rect_.height()) {
+            dirty_cells_ = overall_pathing_map_->cells(Node(dirty_rect_.left(), dirty_rect_.top()),
+                                                       Node(dirty_rect_.right(), dirty_rect_.bottom()));
+        } else {
+            /// the changes are applied together below, so each cell must only be looked at once
+            std::sort(dirty_cells_.begin(), dirty_cells_.end(), [](const Node &a, const Node &b) {
+                return a.y() != b.y() ? a.y() < b.y() : a.x() < b.x();
+            });
+            dirty_cells_.erase(std::unique(dirty_cells_.begin(), dirty_cells_.end()), dirty_cells_.end());
+        }
+        std::vector<Node> cells_to_fill;
+        std::vector<Node> cells_to_unfill;
+        for (const Node &cell : dirty_cells_) {
+            bool filled = own_pathing_map_->filled(cell) || occupancy_[cell.y() * num_cells_wide_ + cell.x()] > 0;
+            if (filled == overall_pathing_map_->filled(cell)) {
+                continue;
+            }
+            (filled ? cells_to_fill : cells_to_unfill).push_back(cell);
+            changed_cells.push_back(cell);
+        }
+        /// all the changes of a flush make a single new version
+        if (!changed_cells.empty()) {
+            overall_pathing_map_->change_filling(cells_to_fill, cells_to_unfill);
+            changed = true;
+        }
+    }
+    dirty_cells_.clear();
+    dirty_rect_ = QRect();
+
+    if (changed) {
+        hierarchical_pathfinder_dirty_ = true;
+    }
+
+    if (pathing_debug_overlay_ != nullptr) {
+        if (merged_all) {
+            pathing_debug_overlay_->pathing_map_changed();
         } else {
-            debugging_pathing_map_rects_.push_back(draw_empty_cell(cell));
+            pathing_debug_overlay_->cells_changed(changed_cells);
         }
+        update_pathing_debug_overlay_entity_boxes();
     }
 }
 
-QGraphicsPolygonItem *Map::draw_empty_cell(Node &cell) {
-    QGraphicsPolygonItem *rect =
-            new QGraphicsPolygonItem(QRectF(0, 0, pathing_map().cell_size(), pathing_map().cell_size()));
-    rect->setPos(cell.x() * pathing_map().cell_size(), cell.y() * pathing_map().cell_size());
-    rect->setPen(QPen(Qt::red));
-    scene_->addItem(rect);
-    return rect;
+/// Returns an unchangeable copy of pathing_map(), for searching paths in other threads.
+///
+/// The copy is only made once per version of pathing_map(), and even then it shares the filling with
+/// pathing_map() until either one changes, so handing a snapshot to every path request costs nothing.
+///
+/// The ConnectedComponents the path service checks requests against are built on pathing_map() (which keeps
+/// them up to date as Entities move) before copying it, so every snapshot shares them instead of building its own.
+/// Once a snapshot `with_clearance_map` was asked for (for agents bigger than one cell), the same goes for the
+/// ClearanceMap.
+///
+/// If `ignoring` is given, the cells that only the additional pathing map `ignoring` fills are unfilled in the
+/// copy (e.g. an Entity's own PathingMap, when searching a path for the Entity itself). Such a copy is made for
+/// every call, and it has a version of its own.
+std::shared_ptr<const PathingMap> Map::pathing_map_snapshot(const PathingMap *ignoring, bool with_clearance_map) {
+    if (with_clearance_map && !clearance_map_wanted_) {
+        clearance_map_wanted_ = true;
+        pathing_map_snapshot_.reset();
+    }
+    if (pathing_map_snapshot_ == nullptr || pathing_map_snapshot_->version() != pathing_map().version()) {
+        overall_pathing_map_->connected_components();
+        if (clearance_map_wanted_) {
+            overall_pathing_map_->clearance_map();
+        }
+        pathing_map_snapshot_ = std::make_shared<const PathingMap>(*overall_pathing_map_);
+    }
+
+    std::vector<Node> cells_to_unfill;
+    for (const auto &ignored : ignored_occupancy(ignoring)) {
+        const Node &cell = ignored.first;
+        if (!own_pathing_map_->filled(cell) && occupancy_[cell.y() * num_cells_wide_ + cell.x()] == ignored.second) {
+            cells_to_unfill.push_back(cell);
+        }
+    }
+    if (cells_to_unfill.empty()) {
+        return pathing_map_snapshot_;
+    }
+    auto snapshot = std::make_shared<PathingMap>(*pathing_map_snapshot_);
+    snapshot->change_filling({}, cells_to_unfill);
+    return snapshot;
 }
 
-QGraphicsPolygonItem *Map::draw_filled_cell(Node &cell) {
-    QGraphicsPolygonItem *rect =
-            new QGraphicsPolygonItem(QRectF(0, 0, pathing_map().cell_size(), pathing_map().cell_size()));
-    rect->setPos(cell.x() * pathing_map().cell_size(), cell.y() * pathing_map().cell_size());
-    rect->setBrush(QBrush(Qt::red));
-    rect->setOpacity(0.25);
-    scene_->addItem(rect);
-    return rect;
+/// Returns a path between the specified positions found by the Map's HierarchicalPathfinder.
+/// If `status` is given, it is set to how the search ended (see PathStatus).
+///
+/// Much faster than pathing_map().shortest_path() for long paths on big Maps, but the path may be a little longer.
+/// The HierarchicalPathfinder only knows 4 directional movement for agents of one cell, options asking for
+/// anything else are searched with pathing_map().shortest_path() instead (the budgets keep that bounded).
+std::vector<QPointF> Map::hierarchical_shortest_path(const QPointF &from_pos, const QPointF &to_pos,
+                                                     const PathingOptions &options, PathStatus *status) {
+    if (options.movement != PathingOptions::Movement::FourDirections || options.agent_size > 1) {
+        return pathing_map().shortest_path(from_pos, to_pos, options, status);
+    }
+
+    if (hierarchical_pathfinder_ == nullptr) {
+        hierarchical_pathfinder_.reset(new HierarchicalPathfinder());
+    }
+    if (hierarchical_pathfinder_dirty_) {
+        hierarchical_pathfinder_->update(pathing_map().path_grid());
+        hierarchical_pathfinder_dirty_ = false;
+    }
+
+    Node from_cell = pathing_map().point_to_cell(from_pos);
+    Node to_cell = pathing_map().point_to_cell(to_pos);
+    std::vector<Node> path = hierarchical_pathfinder_->shortest_path(from_cell, to_cell, options, status);
+    std::vector<QPointF> points;
+    for (const Node &node : path) {
+        points.push_back(pathing_map().cell_to_point(node));
+    }
+    return points;
 }
 
-void Map::draw_entity_bounding_boxes() {
-    remove_and_clear_debugging_polygons(debugging_entity_bounding_boxes_);
-    for (Entity *e : entities_) {
-        debugging_entity_bounding_boxes_.push_back(scene_->addPolygon(e->map_to_map(e->bounding_rect())));
+/// Returns the FlowField towards the cell of the specified position.
+///
+/// FlowFields are cached per goal cell and version of pathing_map(), so all the Entities heading for the same cell
+/// (e.g. a swarm chasing the player) share one search. When pathing_map() changed since (Entities moved), the
+/// cached FlowField is repaired rather than built again (see FlowField), which only looks at the cells around the
+/// moved footprints. Only the movement rules of the options are used, asking for a goal cell with different
+/// movement rules replaces its cached FlowField.
+std::shared_ptr<const FlowField> Map::flow_field(const QPointF &goal_pos, const PathingOptions &options) {
+    Node goal_cell = pathing_map().point_to_cell(goal_pos);
+    std::uint64_t version = pathing_map().version();
+
+    std::shared_ptr<const FlowField> previous;
+    auto cached = flow_fields_.find(goal_cell);
+    if (cached != flow_fields_.end()) {
+        const PathingOptions &cached_options = cached->second.flow_field->options();
+        if (cached_options.movement == options.movement &&
+            cached_options.allow_corner_cutting == options.allow_corner_cutting) {
+            if (cached->second.version == version) {
+                return cached->second.flow_field;
+            }
+            previous = cached->second.flow_field;
+        }
+    }
+
+    /// make room by dropping everything (the goals of a moving swarm change all the time anyway)
+    if (cached == flow_fields_.end() && static_cast<int>(flow_fields_.size()) >= max_cached_flow_fields) {
+        flow_fields_.clear();
+    }
+
+    std::shared_ptr<const FlowField> field;
+    if (previous != nullptr) {
+        field = std::make_shared<const FlowField>(*previous, pathing_map().path_grid());
+    } else {
+        field = std::make_shared<const FlowField>(pathing_map().path_grid(), goal_cell, options);
+    }
+    flow_fields_[goal_cell] = {version, field};
+    return field;
+}
+
+int Map::width() const { return own_pathing_map_->width(); }
+
+int Map::height() const { return own_pathing_map_->height(); }
+
+QSizeF Map::size() const { return QSizeF(width(), height()); }
+
+QPointF Map::cell_to_point(const Node &cell) { return pathing_map().cell_to_point(cell); }
+
+Node Map::point_to_cell(const QPointF &point) { return pathing_map().point_to_cell(point); }
+
+/// Shows (or hides) a PathingDebugOverlay on top of the Map, which draws pathing_map() and the bounding boxes
+/// and PathingMap bounds of the Entities. It is hidden by default, and while hidden it costs nothing.
+void Map::set_pathing_debug_overlay_visible(bool visible) {
+    if (visible == pathing_debug_overlay_visible()) {
+        return;
+    }
+    if (visible) {
+        pathing_debug_overlay_ = new PathingDebugOverlay(pathing_map());
+        scene_->addItem(pathing_debug_overlay_);
+        update_pathing_debug_overlay_entity_boxes();
+    } else {
+        scene_->removeItem(pathing_debug_overlay_);
+        delete pathing_debug_overlay_;
+        pathing_debug_overlay_ = nullptr;
     }
 }
 
-void Map::draw_entity_pathing_map_bounds() {
-    remove_and_clear_debugging_polygons(debugging_entity_pathing_map_boxes_);
+void Map::update_pathing_debug_overlay_entity_boxes() {
+    std::vector<QPolygonF> bounding_boxes;
+    std::vector<QRectF> pathing_bounds;
     for (Entity *e : entities_) {
+        bounding_boxes.push_back(e->map_to_map(e->bounding_rect()));
         QPointF topleft = e->map_to_map(e->pathing_map_pos());
-        QGraphicsPolygonItem *poly = scene_->addPolygon(
-                QRectF(topleft.x(), topleft.y(), e->pathing_map().width(), e->pathing_map().height()),
-                QPen(Qt::yellow));
-        debugging_entity_pathing_map_boxes_.push_back(poly);
+        pathing_bounds.push_back(QRectF(topleft.x(), topleft.y(), e->pathing_map().width(), e->pathing_map().height()));
     }
+    pathing_debug_overlay_->set_entity_boxes(bounding_boxes, pathing_bounds);
 }
 
+/// The entity queries below only look at the Entities in the buckets of entity_hash_ that the region overlaps.
 std::unordered_set<Entity *> Map::entities(const QRectF &rect) {
-    QPolygonF region_as_poly(rect);
     std::unordered_set<Entity *> entities;
-    for (Entity *entity : entities_) {
-        QPolygonF entity_bounding_box = entity->map_to_map(entity->bounding_rect());
-        if (!region_as_poly.intersected(entity_bounding_box).isEmpty()) {
+    for (Entity *entity : entity_hash_.entities(rect)) {
+        if (QtUtils::intersects(entity->bounding_polygon_in_map(), rect)) {
             entities.insert(entity);
         }
     }
@@ -163,9 +431,8 @@ std::unordered_set<Entity *> Map::entities(const QRectF &rect) {
 
 std::unordered_set<Entity *> Map::entities(const QPointF &at_point) {
     std::unordered_set<Entity *> entities;
-    for (Entity *entity : entities_) {
-        QPolygonF rect(entity->map_to_map(entity->bounding_rect()));
-        if (rect.containsPoint(at_point, Qt::FillRule::OddEvenFill)) {
+    for (Entity *entity : entity_hash_.entities(QRectF(at_point, QSizeF(0, 0)))) {
+        if (QtUtils::contains(entity->bounding_polygon_in_map(), at_point)) {
             entities.insert(entity);
         }
     }
@@ -174,9 +441,8 @@ std::unordered_set<Entity *> Map::entities(const QPointF &at_point) {
 
 std::unordered_set<Entity *> Map::entities(const QPolygonF &in_region) {
     std::unordered_set<Entity *> entities;
-    for (Entity *entity : entities_) {
-        QPolygonF entity_box = entity->map_to_map(entity->bounding_rect());
-        if (!entity_box.intersected(in_region).isEmpty()) {
+    for (Entity *entity : entity_hash_.entities(in_region.boundingRect())) {
+        if (QtUtils::intersects(entity->bounding_polygon_in_map(), in_region)) {
             entities.insert(entity);
         }
     }
@@ -313,6 +579,7 @@ void Map::add_entity(Entity *entity) {
 
     /// update Entity's map_ ptr
     entity->map_ = this;
+    entity_hash_.update(entity, entity->bounding_polygon_in_map().boundingRect());
 
     /// update the PathingMap
     add_pathing_map(entity->pathing_map(), entity->map_to_map(entity->pathing_map_pos()));
@@ -352,6 +619,7 @@ void Map::remove_entity(Entity *entity) {
 
     /// set its internal pointer
     entity->map_ = nullptr;
+    entity_hash_.remove(entity);
 
     /// remove the pathing of the Entity
     remove_pathing_map(entity->pathing_map());
@@ -0,0 +1,68 @@
+#include "PathCache.h"
+
+using namespace cute;
+
+PathCache::PathCache(int capacity) : capacity_(capacity) { assert(capacity > 0); }
+
+/// Looks up the path for the specified key. If it is cached, copies it (and its status) into `path` and
+/// `status`, marks it as the most recently used path and returns true.
+bool PathCache::find(const Key &key, std::vector<QPointF> &path, PathStatus &status) {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    path = it->second->path;
+    status = it->second->status;
+    return true;
+}
+
+/// Caches the path for the specified key (replacing what was cached for it), evicting the least recently
+/// used path if the cache is full.
+void PathCache::insert(const Key &key, const std::vector<QPointF> &path, PathStatus status) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->path = path;
+        it->second->status = status;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+    entries_.push_front({key, path, status});
+    index_[key] = entries_.begin();
+    evict();
+}
+
+void PathCache::clear() {
+    entries_.clear();
+    index_.clear();
+}
+
+void PathCache::set_capacity(int capacity) {
+    assert(capacity > 0);
+    capacity_ = capacity;
+    evict();
+}
+
+/// Drops the least recently used paths until the cache is within its capacity.
+void PathCache::evict() {
+    while (static_cast<int>(entries_.size()) > capacity_) {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+size_t PathCache::KeyHash::operator()(const Key &key) const {
+    size_t seed = std::hash<Node>()(key.from);
+    auto combine = [&seed](size_t value) { seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2); };
+    combine(std::hash<Node>()(key.to));
+    combine(std::hash<std::uint64_t>()(key.version));
+    combine(static_cast<size_t>(key.options.algorithm));
+    combine(static_cast<size_t>(key.options.movement));
+    combine(key.options.allow_corner_cutting);
+    combine(key.options.max_expansions);
+    combine(key.options.max_milliseconds);
+    combine(key.options.closest_reachable_fallback);
+    combine(key.options.smooth_path);
+    combine(key.options.agent_size);
+    return seed;
+}
@@ -1,47 +1,154 @@
 #include "PathGrid.h"
-#include "Tree.h"
+#include "PathGridSearch.h"
 
 using namespace cute;
 
-PathGrid::PathGrid(int num_cols, int num_rows) : num_cols_(num_cols), num_rows_(num_rows) {
+PathGrid::PathGrid(int num_cols, int num_rows)
+        : num_cols_(num_cols), num_rows_(num_rows), words_per_row_((num_cols + 63) / 64) {
     assert((num_cols >= 0) && (num_rows >= 0));
 
-    /// populate with nodes
-    for (size_t i = 0; i < num_cols; i++) {
-        std::vector<Node> col_of_nodes;
-        for (size_t j = 0; j < num_rows; j++) {
-            Node node(i, j);
-            col_of_nodes.push_back(node);
+    /// all nodes start out unfilled
+    bits_ = std::make_shared<std::vector<std::uint64_t>>(static_cast<size_t>(words_per_row_) * num_rows_, 0);
+}
+
+/// Makes sure this PathGrid is the only one using its bits (copying them if they are shared) and returns them.
+/// Must be called before every change of the bits.
+std::vector<std::uint64_t> &PathGrid::mutable_bits() {
+    /// only snapshots reach other threads (see the class doc), so when the count drops to 1 every other
+    /// copy is gone for good; the fence orders our writes after the reads those copies made before releasing
+    if (bits_.use_count() > 1) {
+        bits_ = std::make_shared<std::vector<std::uint64_t>>(*bits_);
+    } else {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *bits_;
+}
+
+/// Returns the bits of the valid columns of the specified word of a row.
+/// Bits past the last column are never set, every word-level operation masks with this.
+std::uint64_t PathGrid::column_mask(int word_index) const {
+    int bits_in_word = num_cols_ - word_index * 64;
+    if (bits_in_word >= 64) {
+        return ~std::uint64_t(0);
+    }
+    return (std::uint64_t(1) << bits_in_word) - 1;
+}
+
+/// Returns the filling of the 64 Nodes of row `y` starting at column `x` (bit 0 is column `x`).
+///
+/// Columns outside of the PathGrid (including negative ones) read as unfilled.
+std::uint64_t PathGrid::row_bits(int y, int x) const {
+    if (y < 0 || y >= num_rows_ || x <= -64 || x >= num_cols_) {
+        return 0;
+    }
+    if (x < 0) {
+        return row_bits(y, 0) << -x;
+    }
+
+    const std::uint64_t *row = &(*bits_)[static_cast<size_t>(y) * words_per_row_];
+    int word_index = x / 64;
+    int offset = x % 64;
+    std::uint64_t result = row[word_index] >> offset;
+    if (offset != 0 && word_index + 1 < words_per_row_) {
+        result |= row[word_index + 1] << (64 - offset);
+    }
+    return result;
+}
+
+/// Returns the cells whose filling differs between this PathGrid and `other` (of the same size).
+/// The rows are compared 64 cells at a time, and not at all if both PathGrids still share their bits.
+std::vector<Node> PathGrid::changed_cells(const PathGrid &other) const {
+    assert(num_cols_ == other.num_cols_ && num_rows_ == other.num_rows_);
+
+    std::vector<Node> cells;
+    if (bits_ == other.bits_) {
+        return cells;
+    }
+    for (int y = 0; y < num_rows_; y++) {
+        size_t row_start = static_cast<size_t>(y) * words_per_row_;
+        for (int word_index = 0; word_index < words_per_row_; word_index++) {
+            std::uint64_t changed = (*bits_)[row_start + word_index] ^ (*other.bits_)[row_start + word_index];
+            while (changed) {
+                int x = word_index * 64 + qCountTrailingZeroBits(changed);
+                if (x < num_cols_) {
+                    cells.push_back(Node(x, y));
+                }
+                changed &= changed - 1;
+            }
         }
-        nodes_.push_back(col_of_nodes);
     }
+    return cells;
+}
 
-    /// make all nodes unfilled
-    for (Node node : nodes()) {
-        filled_[node] = false;
+/// Fills/unfills every Node in the (inclusive) rectangle, clipped to the PathGrid, a word at a time.
+void PathGrid::set_region(int x0, int y0, int x1, int y1, bool filled) {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, num_cols_ - 1);
+    y1 = std::min(y1, num_rows_ - 1);
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+    std::vector<std::uint64_t> &bits = mutable_bits();
+    int first_word = x0 / 64;
+    int last_word = x1 / 64;
+    for (int y = y0; y <= y1; y++) {
+        std::uint64_t *row = &bits[static_cast<size_t>(y) * words_per_row_];
+        for (int w = first_word; w <= last_word; w++) {
+            std::uint64_t mask = ~std::uint64_t(0);
+            if (w == first_word) {
+                mask &= ~std::uint64_t(0) << (x0 % 64);
+            }
+            if (w == last_word) {
+                mask &= ~std::uint64_t(0) >> (63 - x1 % 64);
+            }
+            if (filled) {
+                row[w] |= mask;
+            } else {
+                row[w] &= ~mask;
+            }
+        }
     }
 }
 
-/// A PathGrid maintains a mapping of Node:bool determining which Nodes are filled. This member function
-/// will mark the specified node as filled.
-void PathGrid::fill(const Node &node) { filled_[node] = true; }
+/// A PathGrid maintains a bit per Node determining which Nodes are filled. This member function
+/// will mark the specified node as filled. Nodes outside of the PathGrid are ignored.
+void PathGrid::fill(const Node &node) {
+    if (!contains(node)) {
+        return;
+    }
+    mutable_bits()[static_cast<size_t>(node.y()) * words_per_row_ + node.x() / 64] |=
+            std::uint64_t(1) << (node.x() % 64);
+}
 
 void PathGrid::fill(int x, int y) { fill(Node(x, y)); }
 
-void PathGrid::fill() {
-    for (Node node : nodes()) {
-        fill(node);
-    }
+/// Fills all the Nodes in the region, both corners inclusive.
+void PathGrid::fill(const Node &top_left, const Node &bottom_right) {
+    set_region(top_left.x(), top_left.y(), bottom_right.x(), bottom_right.y(), true);
 }
 
-void PathGrid::unfill(const Node &node) { filled_[node] = false; }
+void PathGrid::fill() { set_region(0, 0, num_cols_ - 1, num_rows_ - 1, true); }
+
+void PathGrid::unfill(const Node &node) {
+    if (!contains(node)) {
+        return;
+    }
+    mutable_bits()[static_cast<size_t>(node.y()) * words_per_row_ + node.x() / 64] &=
+            ~(std::uint64_t(1) << (node.x() % 64));
+}
 
 void PathGrid::unfill(int x, int y) { unfill(Node(x, y)); }
 
+/// Unfills all the Nodes in the region, both corners inclusive.
+void PathGrid::unfill(const Node &top_left, const Node &bottom_right) {
+    set_region(top_left.x(), top_left.y(), bottom_right.x(), bottom_right.y(), false);
+}
+
 void PathGrid::unfill() {
-    for (Node node : nodes()) {
-        unfill(node);
-    }
+    std::vector<std::uint64_t> &bits = mutable_bits();
+    std::fill(bits.begin(), bits.end(), 0);
 }
 
 /// Fills/unfills Nodes based on the values of a 2d int vector.
@@ -49,13 +156,12 @@ void PathGrid::unfill() {
 /// A value of 0 means that the specfied Node should be unfilled. Any other value
 /// means that it should be filled. Please ensure that the 2d vector is the same
 /// size as the PathGrid. If it is shorter, the remaining Nodes will be unfilled.
-/// If it is longer, you will get an out of range error.=
+/// If it is longer, the extra values are ignored.
 void PathGrid::set_filling(const std::vector<std::vector<int>> &vec) {
-    for (int y = 0, n = nodes_[0].size(); y < n; y++) {
-        for (int x = 0, p = nodes_.size(); x < p; x++) {
-            if (vec[y][x] == 0) {
-                unfill(x, y);
-            } else {
+    unfill();
+    for (int y = 0, n = std::min<int>(num_rows_, vec.size()); y < n; y++) {
+        for (int x = 0, p = std::min<int>(num_cols_, vec[y].size()); x < p; x++) {
+            if (vec[y][x] != 0) {
                 fill(x, y);
             }
         }
@@ -66,39 +172,45 @@ void PathGrid::set_filling(const std::vector<std::vector<int>> &vec) {
 /// as that of the specified PathGrid.
 void PathGrid::set_filling(const PathGrid &path_grid, const Node &pos) {
     /// approach:
-    /// -traverse through Nodes of new PathGrid
-    /// -set shadowed Node to be the same fillness
+    /// -unfill the shadowed region
+    /// -merge the new PathGrid into it
 
-    for (Node node : path_grid.nodes()) {
-        Node shadowed(node.x() + pos.x(), node.y() + pos.y());
-        if (path_grid.filled(node)) {
-            fill(shadowed);
-        } else {
-            unfill(shadowed);
-        }
-    }
+    set_region(pos.x(), pos.y(), pos.x() + path_grid.num_cols() - 1, pos.y() + path_grid.num_rows() - 1, false);
+    add_path_grid(path_grid, pos);
 }
 
 /// Adds the specified PathGrid to this PathGrid at the specified positino.
 ///
 /// The resulting PathGrid can be more filled but not less filled.
+/// Parts of the specified PathGrid that fall outside of this PathGrid are ignored.
 void PathGrid::add_path_grid(const PathGrid &path_grid, const Node &pos) {
     /// approach
-    /// -traverse through Nodes of new path
-    /// -if Node is filled, make sure shadowed is filled too
-
-    for (Node node : path_grid.nodes()) {
-        Node shadowed(node.x() + pos.x(), node.y() + pos.y());
-        /// if node is filled and shadowed node is not
-        if (path_grid.filled(node)) {
-            fill(shadowed);
+    /// -for each shadowed row, OR in the (shifted) bits of the new row a word at a time
+
+    int x0 = std::max(pos.x(), 0);
+    int x1 = std::min(pos.x() + path_grid.num_cols(), num_cols_) - 1;
+    if (x0 > x1) {
+        return;
+    }
+    std::vector<std::uint64_t> &bits = mutable_bits();
+    int first_word = x0 / 64;
+    int last_word = x1 / 64;
+
+    for (int src_y = 0, n = path_grid.num_rows(); src_y < n; src_y++) {
+        int y = src_y + pos.y();
+        if (y < 0 || y >= num_rows_) {
+            continue;
+        }
+        std::uint64_t *row = &bits[static_cast<size_t>(y) * words_per_row_];
+        for (int w = first_word; w <= last_word; w++) {
+            row[w] |= path_grid.row_bits(src_y, w * 64 - pos.x()) & column_mask(w);
         }
     }
 }
 
 bool PathGrid::filled(const Node &node) const {
     assert(contains(node));
-    return filled_.find(node)->second;
+    return ((*bits_)[static_cast<size_t>(node.y()) * words_per_row_ + node.x() / 64] >> (node.x() % 64)) & 1;
 }
 
 bool PathGrid::filled(int x, int y) const { return filled(Node(x, y)); }
@@ -139,34 +251,131 @@ std::vector<Node> PathGrid::unfilled_neighbors(const Node &node) const {
     return neighbors;
 }
 
-/// Returns a Graph representation of the PathGrid.
+/// Returns the unfilled neighboring Nodes of the specified Node that can be moved to with the specified options.
 ///
-/// More specifically, returns a Graph containing all the *unfilled* Nodes and the Edges between them.
-/// The start and end node will be included in the graph even if they are filled,
-/// that is why they must be passed to this function.
-Graph PathGrid::to_graph(const Node &start, const Node &end) const {
-    Graph g;
-
-    /// add all unfilled nodes (add start/end Nodes even if they are filled)
-    for (Node node : nodes()) {
-        if (!filled(node) || node == start || node == end) {
-            g.add_node(node);
-        }
+/// With 8 directional movement the diagonal neighbors are included too, if the corner cutting rule allows it.
+std::vector<Node> PathGrid::unfilled_neighbors(const Node &node, const PathingOptions &options) const {
+    std::vector<Node> neighbors = unfilled_neighbors(node);
+    if (options.movement != PathingOptions::Movement::EightDirections) {
+        return neighbors;
     }
 
-    /// add all edges between unfilled nodes
-    for (Node node : g.nodes()) {
-        for (Node neighbor : unfilled_neighbors(node)) {
-            g.add_edge(node, neighbor, 1);
-            g.add_edge(neighbor, node, 1);
+    for (int dy = -1; dy <= 1; dy += 2) {
+        for (int dx = -1; dx <= 1; dx += 2) {
+            Node n(node.x() + dx, node.y() + dy);
+            if (!contains(n) || filled(n)) {
+                continue;
+            }
+            bool horizontal_free = !filled(n.x(), node.y());
+            bool vertical_free = !filled(node.x(), n.y());
+            if ((horizontal_free && vertical_free) ||
+                (options.allow_corner_cutting && (horizontal_free || vertical_free))) {
+                neighbors.push_back(n);
+            }
         }
     }
+    return neighbors;
+}
+
+/// Returns the shortest path between the specified Nodes (both included), see PathGridSearch::shortest_path().
+///
+/// The search runs directly on the grid. Each thread keeps its own search arrays around,
+/// so repeated queries (e.g. from a path finding worker thread) don't reallocate them.
+/// If `status` is given, it is set to how the search ended.
+///
+/// Searches for agents bigger than one cell need the ClearanceMap of this PathGrid. Pass one that is kept around
+/// (see PathingMap::clearance_map()), otherwise one is built for this search only.
+std::vector<Node> PathGrid::shortest_path(const Node &from, const Node &to, const PathingOptions &options,
+                                          PathStatus *status, const ClearanceMap *clearance) const {
+    std::unique_ptr<ClearanceMap> own_clearance;
+    if (options.agent_size > 1 && clearance == nullptr) {
+        own_clearance.reset(new ClearanceMap(*this));
+        clearance = own_clearance.get();
+    }
 
-    return g;
+    thread_local PathGridSearch search;
+    std::vector<Node> path = search.shortest_path(*this, from, to, options, clearance);
+    if (status) {
+        *status = search.status();
+    }
+    if (options.smooth_path) {
+        return smooth_path(path, options.agent_size, clearance);
+    }
+    return path;
 }
 
-std::vector<Node> PathGrid::shortest_path(const Node &from, const Node &to) const {
-    return to_graph(from, to).shortest_path(from, to);
+/// Returns true if the straight line between the centers of the specified Nodes only passes through unfilled
+/// Nodes (the two Nodes themselves are not checked). A line going exactly through a corner touches both
+/// Nodes beside the corner, so it can't squeeze between two diagonal filled Nodes.
+///
+/// For an agent bigger than one Node, the Nodes passed through must instead have room for the agent (the
+/// `clearance` of this PathGrid is needed then).
+bool PathGrid::line_of_sight(const Node &from, const Node &to, int agent_size, const ClearanceMap *clearance) const {
+    assert(contains(from) && contains(to));
+    assert(agent_size <= 1 || clearance != nullptr);
+    auto blocked = [&](int x, int y) { return (agent_size > 1) ? !clearance->fits(x, y, agent_size) : filled(x, y); };
+
+    int x = from.x();
+    int y = from.y();
+    int distance_x = abs(to.x() - x);
+    int distance_y = abs(to.y() - y);
+    int step_x = (to.x() > x) ? 1 : -1;
+    int step_y = (to.y() > y) ? 1 : -1;
+
+    /// error > 0 if the line crosses the next vertical cell border before the next horizontal one (scaled by 2 *
+    /// distance_x * distance_y so it stays an integer), error == 0 if it crosses both at once (at a corner)
+    int error = distance_x - distance_y;
+    int steps_left = distance_x + distance_y;
+    while (steps_left > 0) {
+        if (error > 0) {
+            x += step_x;
+            error -= 2 * distance_y;
+            steps_left--;
+        } else if (error < 0) {
+            y += step_y;
+            error += 2 * distance_x;
+            steps_left--;
+        } else {
+            if (blocked(x + step_x, y) || blocked(x, y + step_y)) {
+                return false;
+            }
+            x += step_x;
+            y += step_y;
+            error += 2 * (distance_x - distance_y);
+            steps_left -= 2;
+        }
+        if (steps_left > 0 && blocked(x, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Reduces a path (as returned by shortest_path()) to the Nodes where it has to turn, by walking from each kept
+/// Node as far along the path as there is a line_of_sight() and keeping the Node reached (string pulling).
+///
+/// The Node before the end is always kept, so the last step still leads from a neighbor into the end Node
+/// (which may be filled, e.g. by the Entity being walked to).
+std::vector<Node> PathGrid::smooth_path(const std::vector<Node> &path, int agent_size,
+                                        const ClearanceMap *clearance) const {
+    if (path.size() <= 3) {
+        return path;
+    }
+
+    std::vector<Node> smoothed;
+    smoothed.push_back(path.front());
+    int last = path.size() - 2;
+    int anchor = 0;
+    while (anchor < last) {
+        int reached = anchor + 1;
+        while (reached < last && line_of_sight(path[anchor], path[reached + 1], agent_size, clearance)) {
+            reached++;
+        }
+        smoothed.push_back(path[reached]);
+        anchor = reached;
+    }
+    smoothed.push_back(path.back());
+    return smoothed;
 }
 
 std::vector<Node> PathGrid::column(int i) const { return nodes(Node(i, 0), Node(i, num_rows_ - 1)); }
@@ -187,4 +396,15 @@ std::vector<Node> PathGrid::nodes(const Node &top_left, const Node &bottom_right
 
 std::vector<Node> PathGrid::nodes() const { return nodes(Node(0, 0), Node(num_cols_ - 1, num_rows_ - 1)); }
 
-bool PathGrid::contains(const Node &node) const { return node.x() < num_cols_ && node.y() < num_rows_; }
+bool PathGrid::contains(const Node &node) const {
+    return node.x() >= 0 && node.y() >= 0 && node.x() < num_cols_ && node.y() < num_rows_;
+}
+
+bool cute::operator==(const PathGrid &lhs, const PathGrid &rhs) {
+    if (lhs.num_cols_ != rhs.num_cols_ || lhs.num_rows_ != rhs.num_rows_) {
+        return false;
+    }
+    return lhs.bits_ == rhs.bits_ || *lhs.bits_ == *rhs.bits_;
+}
+
+bool cute::operator!=(const PathGrid &lhs, const PathGrid &rhs) { return !(lhs == rhs); }
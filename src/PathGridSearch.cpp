@@ -0,0 +1,529 @@
+#include "PathGridSearch.h"
+
+using namespace cute;
+
+namespace {
+
+/// up, down, left, right, then the diagonals
+const int dx[] = {0, 0, -1, 1, -1, 1, -1, 1};
+const int dy[] = {-1, 1, 0, 0, -1, -1, 1, 1};
+
+/// returns the index into dx/dy of the specified direction
+int direction_index(int dir_x, int dir_y) {
+    for (int i = 0; i < 8; i++) {
+        if (dx[i] == dir_x && dy[i] == dir_y) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+/// Makes the search arrays big enough for the grid, starts a new generation and remembers the query.
+void PathGridSearch::begin_search(const PathGrid &grid, const Node &to, const PathingOptions &options) {
+    grid_ = &grid;
+    options_ = options;
+    num_cols_ = grid.num_cols();
+    num_rows_ = grid.num_rows();
+    to_x_ = to.x();
+    to_y_ = to.y();
+    to_cell_ = to.y() * num_cols_ + to.x();
+    num_expanded_ = 0;
+    closest_cell_ = -1;
+    budget_exceeded_ = false;
+    if (options.max_milliseconds > 0) {
+        deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(options.max_milliseconds);
+    }
+
+    size_t num_cells = static_cast<size_t>(num_cols_) * num_rows_;
+    if (g_cost_.size() < num_cells) {
+        g_cost_.resize(num_cells);
+        parent_.resize(num_cells);
+        visited_generation_.resize(num_cells, 0);
+        closed_generation_.resize(num_cells, 0);
+    }
+
+    generation_++;
+
+    /// the counter wrapped around, old stamps could look current again, so clear them once
+    if (generation_ == 0) {
+        std::fill(visited_generation_.begin(), visited_generation_.end(), 0);
+        std::fill(closed_generation_.begin(), closed_generation_.end(), 0);
+        generation_ = 1;
+    }
+
+    /// the open list is a binary heap, entries whose cell got a better G cost later are skipped when popped
+    open_nodes_.clear();
+}
+
+/// A cell can be walked on if it is in the grid and unfilled (or for bigger agents, if the agent fits there).
+/// The target cell can always be walked on.
+bool PathGridSearch::passable(int x, int y) const {
+    if (x < 0 || y < 0 || x >= num_cols_ || y >= num_rows_) {
+        return false;
+    }
+    if (x == to_x_ && y == to_y_) {
+        return true;
+    }
+    if (options_.agent_size > 1) {
+        return clearance_->fits(x, y, options_.agent_size);
+    }
+    return !grid_->filled(x, y);
+}
+
+/// Returns true if a diagonal step from (x,y) to (x+dx,y+dy) is allowed by the corner cutting rule.
+/// The cell stepped to itself is not checked.
+bool PathGridSearch::diagonal_step_allowed(int x, int y, int dx, int dy) const {
+    bool horizontal_free = passable(x + dx, y);
+    bool vertical_free = passable(x, y + dy);
+    if (options_.allow_corner_cutting) {
+        return horizontal_free || vertical_free;
+    }
+    return horizontal_free && vertical_free;
+}
+
+/// Returns the cost of the cheapest path from (x0,y0) to (x1,y1) if there were no obstacles
+/// (the Manhattan distance for 4 directional movement, the octile distance for 8 directional movement).
+int PathGridSearch::distance(int x0, int y0, int x1, int y1) const {
+    int distance_x = abs(x1 - x0);
+    int distance_y = abs(y1 - y0);
+    if (options_.movement == PathingOptions::Movement::FourDirections) {
+        return PathingOptions::straight_move_cost * (distance_x + distance_y);
+    }
+    int diagonal_steps = std::min(distance_x, distance_y);
+    int straight_steps = std::max(distance_x, distance_y) - diagonal_steps;
+    return PathingOptions::diagonal_move_cost * diagonal_steps + PathingOptions::straight_move_cost * straight_steps;
+}
+
+void PathGridSearch::push_open(const OpenEntry &entry) {
+    open_nodes_.push_back(entry);
+    std::push_heap(open_nodes_.begin(), open_nodes_.end(), OpenEntryCompare());
+}
+
+PathGridSearch::OpenEntry PathGridSearch::pop_open() {
+    std::pop_heap(open_nodes_.begin(), open_nodes_.end(), OpenEntryCompare());
+    OpenEntry entry = open_nodes_.back();
+    open_nodes_.pop_back();
+    return entry;
+}
+
+/// Records `from_cell` as the parent of `cell` and (re)opens it, if `g_cost` is better than what `cell` has so far.
+void PathGridSearch::relax(int cell, int from_cell, int g_cost) {
+    if (closed(cell) || (visited(cell) && g_cost >= g_cost_[cell])) {
+        return;
+    }
+    visited_generation_[cell] = generation_;
+    g_cost_[cell] = g_cost;
+    parent_[cell] = from_cell;
+
+    int cell_h_cost = h_cost(cell % num_cols_, cell / num_cols_);
+    push_open({g_cost + cell_h_cost, cell_h_cost, g_cost, cell});
+
+    if (cell_h_cost < closest_h_cost_ || (cell_h_cost == closest_h_cost_ && g_cost < g_cost_[closest_cell_])) {
+        closest_cell_ = cell;
+        closest_h_cost_ = cell_h_cost;
+    }
+}
+
+/// Closes the specified cell (just taken off the open list) so its neighbors can be opened, if the budget allows it.
+/// Returns false (leaving the cell open) if the search has to stop because the budget ran out.
+bool PathGridSearch::expand(int cell) {
+    if (options_.max_expansions > 0 && num_expanded_ >= options_.max_expansions) {
+        budget_exceeded_ = true;
+    }
+    /// reading the clock is not free, so the time budget is only checked every 64 expansions
+    if (options_.max_milliseconds > 0 && (num_expanded_ & 63) == 63 && std::chrono::steady_clock::now() >= deadline_) {
+        budget_exceeded_ = true;
+    }
+    if (budget_exceeded_) {
+        return false;
+    }
+
+    closed_generation_[cell] = generation_;
+    num_expanded_++;
+    return true;
+}
+
+/// Returns a vector of Nodes that represent the shortest path between the specified Nodes.
+///
+/// The path includes both end Nodes and every cell in between, whatever algorithm is used.
+/// Consecutive Nodes are 4-connected, or 8-connected if the options allow 8 directional movement.
+/// The start and end Node may be filled, all other Nodes of the path are unfilled.
+/// Returns an empty vector if `from` == `to`, if either Node is outside the grid or if `to` can not be reached.
+///
+/// If `to` can not be reached (or the search runs out of budget) and the options ask for the
+/// closest_reachable_fallback, the path to the visited cell closest to `to` is returned instead.
+/// status() tells which of these happened.
+///
+/// With an agent_size above 1, `clearance` must be the ClearanceMap of `grid`.
+std::vector<Node> PathGridSearch::shortest_path(const PathGrid &grid, const Node &from, const Node &to,
+                                                const PathingOptions &options, const ClearanceMap *clearance) {
+    assert(options.agent_size <= 1 || clearance != nullptr);
+
+    if (from == to) {
+        status_ = PathStatus::Found;
+        return std::vector<Node>();
+    }
+    if (!grid.contains(from) || !grid.contains(to)) {
+        status_ = PathStatus::Unreachable;
+        return std::vector<Node>();
+    }
+
+    begin_search(grid, to, options);
+    clearance_ = clearance;
+
+    int from_cell = from.y() * num_cols_ + from.x();
+    g_cost_[from_cell] = 0;
+    parent_[from_cell] = -1;
+    visited_generation_[from_cell] = generation_;
+    int from_h_cost = h_cost(from.x(), from.y());
+    push_open({from_h_cost, from_h_cost, 0, from_cell});
+    closest_cell_ = from_cell;
+    closest_h_cost_ = from_h_cost;
+
+    /// Jump Point Search has no variant that allows corner cutting, such searches use A*. It also scans the grid
+    /// bits directly, so searches for bigger agents use A* too.
+    bool found;
+    if (options.algorithm != PathingOptions::Algorithm::JumpPointSearch || options.agent_size > 1) {
+        found = a_star();
+    } else if (options.movement == PathingOptions::Movement::FourDirections) {
+        found = jump_point_search();
+    } else if (!options.allow_corner_cutting) {
+        found = diagonal_jump_point_search();
+    } else {
+        found = a_star();
+    }
+
+    if (found) {
+        status_ = PathStatus::Found;
+        return build_path(to_cell_);
+    }
+
+    status_ = budget_exceeded_ ? PathStatus::BudgetExceeded : PathStatus::Unreachable;
+    if (!options.closest_reachable_fallback || closest_cell_ == from_cell) {
+        return std::vector<Node>();
+    }
+    if (status_ == PathStatus::Unreachable) {
+        status_ = PathStatus::Partial;
+    }
+    return build_path(closest_cell_);
+}
+
+/// Plain A*, every unfilled neighbor of an expanded cell is opened.
+bool PathGridSearch::a_star() {
+    int num_directions = (options_.movement == PathingOptions::Movement::EightDirections) ? 8 : 4;
+    while (!open_nodes_.empty()) {
+        OpenEntry current = pop_open();
+        if (closed(current.cell) || current.g_cost != g_cost_[current.cell]) {
+            continue;
+        }
+        /// if current node is the target node, path has been found
+        if (current.cell == to_cell_) {
+            return true;
+        }
+        if (!expand(current.cell)) {
+            return false;
+        }
+
+        int x = current.cell % num_cols_;
+        int y = current.cell / num_cols_;
+        for (int i = 0; i < num_directions; i++) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (!passable(nx, ny)) {
+                continue;
+            }
+            if (i < 4) {
+                relax(ny * num_cols_ + nx, current.cell, current.g_cost + PathingOptions::straight_move_cost);
+            } else if (diagonal_step_allowed(x, y, dx[i], dy[i])) {
+                relax(ny * num_cols_ + nx, current.cell, current.g_cost + PathingOptions::diagonal_move_cost);
+            }
+        }
+    }
+    return false;
+}
+
+/// Jump Point Search for 4-connected grids.
+///
+/// Among all the equally short paths, only the "canonical" ones are searched: paths that move vertically as
+/// early as possible. Such a path may turn from vertical to horizontal anywhere, but it only turns from
+/// horizontal to vertical right after an obstacle that blocked moving vertically one cell earlier.
+/// So a horizontal scan can skip cells until it hits such a turning point (or the target), and a vertical scan
+/// skips cells until a horizontal scan started from one of them finds something. Only those "jump points"
+/// ever go into the open list.
+bool PathGridSearch::jump_point_search() {
+    while (!open_nodes_.empty()) {
+        OpenEntry current = pop_open();
+        if (closed(current.cell) || current.g_cost != g_cost_[current.cell]) {
+            continue;
+        }
+        if (current.cell == to_cell_) {
+            return true;
+        }
+        if (!expand(current.cell)) {
+            return false;
+        }
+
+        int x = current.cell % num_cols_;
+        int y = current.cell / num_cols_;
+
+        /// direction in which the current cell was entered (none for the start cell)
+        int move_x = 0;
+        int move_y = 0;
+        int parent = parent_[current.cell];
+        if (parent != -1) {
+            move_x = (x > parent % num_cols_) - (x < parent % num_cols_);
+            move_y = (y > parent / num_cols_) - (y < parent / num_cols_);
+        }
+
+        /// find out which directions (a canonical path through the current cell) can continue in
+        bool directions[4] = {false, false, false, false}; /// up, down, left, right
+        if (move_x == 0 && move_y == 0) {
+            directions[0] = directions[1] = directions[2] = directions[3] = true;
+        } else if (move_y != 0) {
+            directions[move_y < 0 ? 0 : 1] = true;
+            directions[2] = directions[3] = true;
+        } else {
+            directions[move_x < 0 ? 2 : 3] = true;
+            directions[0] = passable(x, y - 1) && !passable(x - move_x, y - 1);
+            directions[1] = passable(x, y + 1) && !passable(x - move_x, y + 1);
+        }
+
+        for (int i = 0; i < 4; i++) {
+            if (!directions[i]) {
+                continue;
+            }
+            int jump_point = (dx[i] != 0) ? jump_horizontal(x, y, dx[i]) : jump_vertical(x, y, dy[i]);
+            if (jump_point == -1) {
+                continue;
+            }
+            relax(jump_point, current.cell,
+                  current.g_cost + distance(x, y, jump_point % num_cols_, jump_point / num_cols_));
+        }
+    }
+    return false;
+}
+
+/// Jump Point Search for 8-connected grids where diagonal steps may not cut corners.
+///
+/// Diagonal scans check a horizontal and a vertical scan at every cell they pass and stop where one of those
+/// finds something. Straight scans stop where a filled cell beside them ends (a "forced" neighbor), since
+/// without corner cutting that is the first cell from which the space behind the obstacle can be reached.
+bool PathGridSearch::diagonal_jump_point_search() {
+    while (!open_nodes_.empty()) {
+        OpenEntry current = pop_open();
+        if (closed(current.cell) || current.g_cost != g_cost_[current.cell]) {
+            continue;
+        }
+        if (current.cell == to_cell_) {
+            return true;
+        }
+        if (!expand(current.cell)) {
+            return false;
+        }
+
+        int x = current.cell % num_cols_;
+        int y = current.cell / num_cols_;
+
+        int move_x = 0;
+        int move_y = 0;
+        int parent = parent_[current.cell];
+        if (parent != -1) {
+            move_x = (x > parent % num_cols_) - (x < parent % num_cols_);
+            move_y = (y > parent / num_cols_) - (y < parent / num_cols_);
+        }
+
+        /// find out which directions (indices into dx/dy) a path through the current cell can continue in
+        bool directions[8] = {false, false, false, false, false, false, false, false};
+        if (move_x == 0 && move_y == 0) {
+            for (int i = 0; i < 8; i++) {
+                directions[i] = (i < 4) || diagonal_step_allowed(x, y, dx[i], dy[i]);
+            }
+        } else if (move_x != 0 && move_y != 0) {
+            directions[direction_index(move_x, 0)] = true;
+            directions[direction_index(0, move_y)] = true;
+            directions[direction_index(move_x, move_y)] = diagonal_step_allowed(x, y, move_x, move_y);
+        } else if (move_x != 0) {
+            bool next_free = passable(x + move_x, y);
+            bool up_free = passable(x, y - 1);
+            bool down_free = passable(x, y + 1);
+            directions[direction_index(move_x, 0)] = true;
+            directions[direction_index(move_x, -1)] = next_free && up_free;
+            directions[direction_index(move_x, 1)] = next_free && down_free;
+            directions[direction_index(0, -1)] = up_free;
+            directions[direction_index(0, 1)] = down_free;
+        } else {
+            bool next_free = passable(x, y + move_y);
+            bool left_free = passable(x - 1, y);
+            bool right_free = passable(x + 1, y);
+            directions[direction_index(0, move_y)] = true;
+            directions[direction_index(-1, move_y)] = next_free && left_free;
+            directions[direction_index(1, move_y)] = next_free && right_free;
+            directions[direction_index(-1, 0)] = left_free;
+            directions[direction_index(1, 0)] = right_free;
+        }
+
+        for (int i = 0; i < 8; i++) {
+            if (!directions[i]) {
+                continue;
+            }
+            int jump_point;
+            if (dy[i] == 0) {
+                jump_point = jump_horizontal(x, y, dx[i]);
+            } else if (dx[i] == 0) {
+                jump_point = jump_vertical_straight(x, y, dy[i]);
+            } else {
+                jump_point = jump_diagonal(x, y, dx[i], dy[i]);
+            }
+            if (jump_point == -1) {
+                continue;
+            }
+            relax(jump_point, current.cell,
+                  current.g_cost + distance(x, y, jump_point % num_cols_, jump_point / num_cols_));
+        }
+    }
+    return false;
+}
+
+/// Returns the passability of the 64 cells of row `y` starting at column `x` (bit 0 is column `x`).
+/// Cells outside of the grid are not passable, the target cell always is.
+std::uint64_t PathGridSearch::passable_bits(int y, int x) const {
+    if (y < 0 || y >= num_rows_ || x <= -64 || x >= num_cols_) {
+        return 0;
+    }
+
+    std::uint64_t bits = ~grid_->row_bits(y, x);
+    if (x < 0) {
+        bits &= ~std::uint64_t(0) << -x;
+    }
+    if (num_cols_ - x < 64) {
+        bits &= (std::uint64_t(1) << (num_cols_ - x)) - 1;
+    }
+    if (y == to_y_ && to_x_ >= x && to_x_ < x + 64) {
+        bits |= std::uint64_t(1) << (to_x_ - x);
+    }
+    return bits;
+}
+
+/// Scans from (x,y) in the horizontal direction `dx` and returns the first jump point, -1 if there is none.
+///
+/// The scan looks at 64 cells at a time: the cells of the row that are blocked, and the cells where a vertical
+/// move is possible that was blocked one cell earlier (the "forced" turns), each come out as one word.
+int PathGridSearch::jump_horizontal(int x, int y, int dx) const {
+    /// bit i of every word below is cell (first + i) of its row
+    int first = (dx > 0) ? x + 1 : x - 64;
+    while (true) {
+        std::uint64_t blocked = ~passable_bits(y, first);
+
+        /// the previous cell of a cell is the one it was entered from, i.e. one cell against the scan direction
+        std::uint64_t up = passable_bits(y - 1, first);
+        std::uint64_t down = passable_bits(y + 1, first);
+        std::uint64_t previous_up = passable_bits(y - 1, first - dx);
+        std::uint64_t previous_down = passable_bits(y + 1, first - dx);
+        std::uint64_t stops = (up & ~previous_up) | (down & ~previous_down);
+        if (y == to_y_ && to_x_ >= first && to_x_ < first + 64) {
+            stops |= std::uint64_t(1) << (to_x_ - first);
+        }
+
+        if (dx > 0) {
+            int first_stop = stops ? qCountTrailingZeroBits(stops) : 64;
+            int first_blocked = blocked ? qCountTrailingZeroBits(blocked) : 64;
+            if (first_stop < first_blocked) {
+                return y * num_cols_ + first + first_stop;
+            }
+        } else {
+            int last_stop = stops ? 63 - qCountLeadingZeroBits(stops) : -1;
+            int last_blocked = blocked ? 63 - qCountLeadingZeroBits(blocked) : -1;
+            if (last_stop > last_blocked) {
+                return y * num_cols_ + first + last_stop;
+            }
+        }
+        if (blocked) {
+            return -1;
+        }
+        first += 64 * dx;
+    }
+}
+
+/// Scans from (x,y) in the vertical direction `dy` and returns the first jump point, -1 if there is none.
+int PathGridSearch::jump_vertical(int x, int y, int dy) const {
+    while (true) {
+        y += dy;
+        if (!passable(x, y)) {
+            return -1;
+        }
+        if (x == to_x_ && y == to_y_) {
+            return y * num_cols_ + x;
+        }
+
+        /// turning horizontal here leads somewhere interesting
+        if (jump_horizontal(x, y, -1) != -1 || jump_horizontal(x, y, 1) != -1) {
+            return y * num_cols_ + x;
+        }
+    }
+}
+
+/// Scans from (x,y) in the vertical direction `dy` for diagonal_jump_point_search() and returns the first jump point,
+/// -1 if there is none. This is the vertical counterpart of jump_horizontal().
+int PathGridSearch::jump_vertical_straight(int x, int y, int dy) const {
+    while (true) {
+        y += dy;
+        if (!passable(x, y)) {
+            return -1;
+        }
+        if (x == to_x_ && y == to_y_) {
+            return y * num_cols_ + x;
+        }
+        if ((passable(x - 1, y) && !passable(x - 1, y - dy)) || (passable(x + 1, y) && !passable(x + 1, y - dy))) {
+            return y * num_cols_ + x;
+        }
+    }
+}
+
+/// Scans from (x,y) in the diagonal direction (dx,dy) and returns the first jump point, -1 if there is none.
+/// The first diagonal step must already have been checked with diagonal_step_allowed().
+int PathGridSearch::jump_diagonal(int x, int y, int dx, int dy) const {
+    while (true) {
+        x += dx;
+        y += dy;
+        if (!passable(x, y)) {
+            return -1;
+        }
+        if (x == to_x_ && y == to_y_) {
+            return y * num_cols_ + x;
+        }
+
+        /// going straight from here leads somewhere interesting
+        if (jump_horizontal(x, y, dx) != -1 || jump_vertical_straight(x, y, dy) != -1) {
+            return y * num_cols_ + x;
+        }
+        if (!diagonal_step_allowed(x, y, dx, dy)) {
+            return -1;
+        }
+    }
+}
+
+/// Follows the parents from the specified cell back to the start and returns the path start->cell.
+/// Parents may be several cells apart (jump points), but always in a straight (or diagonal) line,
+/// the cells between are filled in.
+std::vector<Node> PathGridSearch::build_path(int to_cell) const {
+    std::vector<Node> path;
+    int cell = to_cell;
+    path.push_back(Node(cell % num_cols_, cell / num_cols_));
+    while (parent_[cell] != -1) {
+        int parent = parent_[cell];
+        int x = cell % num_cols_;
+        int y = cell / num_cols_;
+        int step_x = (parent % num_cols_ > x) - (parent % num_cols_ < x);
+        int step_y = (parent / num_cols_ > y) - (parent / num_cols_ < y);
+        while (x != parent % num_cols_ || y != parent / num_cols_) {
+            x += step_x;
+            y += step_y;
+            path.push_back(Node(x, y));
+        }
+        cell = parent;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,200 @@
+#include "PathService.h"
+
+using namespace cute;
+
+namespace {
+
+/// the PathService returned by instance(), null until it is created and again once the application deleted it
+QPointer<PathService> &shared_service() {
+    static QPointer<PathService> service;
+    return service;
+}
+
+} // namespace
+
+/// Returns the PathService shared by the whole game (one worker per core), created on first use.
+///
+/// It is a child of the application and is shut down when the application is about to quit, so its workers
+/// are stopped while the application (and everything the callbacks touch) still exists.
+/// Must be called after the application has been created.
+PathService *PathService::instance() {
+    QPointer<PathService> &service = shared_service();
+    if (service == nullptr) {
+        QCoreApplication *application = QCoreApplication::instance();
+        assert(application != nullptr);
+        service = new PathService();
+        service->setParent(application);
+        QObject::connect(application, &QCoreApplication::aboutToQuit, service, &PathService::shutdown);
+    }
+    return service;
+}
+
+/// Returns the PathService shared by the whole game if instance() created it (and the application has not
+/// deleted it yet), else nullptr. Use it to cancel requests without starting the workers just for that.
+PathService *PathService::existing() { return shared_service(); }
+
+PathService::PathService(int num_workers) : cache_(256) {
+    num_workers = std::max(num_workers, 1);
+    for (int i = 0; i < num_workers; i++) {
+        workers_.push_back(std::thread(&PathService::work, this));
+    }
+}
+
+PathService::~PathService() { shutdown(); }
+
+/// Stops the workers. Jobs that were not picked up yet are dropped, the ones being worked on are finished first,
+/// and no callback is called afterwards. Requests made after this are ignored.
+void PathService::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        jobs_.clear();
+        queued_jobs_.clear();
+        latest_tickets_.clear();
+    }
+    job_available_.notify_all();
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+/// Asks for a path between the specified points, the callback is called with it later on
+/// (never before this function returns). Replaces any earlier request of the same requester.
+void PathService::request_path(const void *requester, std::shared_ptr<const PathingMap> pathing_map,
+                               const QPointF &start, const QPointF &end, const PathingOptions &options,
+                               Callback callback) {
+    if (workers_.empty()) {
+        return;
+    }
+    PathCache::Key key{pathing_map->point_to_cell(start), pathing_map->point_to_cell(end), pathing_map->version(),
+                       options};
+
+    std::vector<QPointF> path;
+    PathStatus status;
+    bool answered = cache_.find(key, path, status);
+    if (answered) {
+        cache_hits_++;
+    } else {
+        cache_misses_++;
+    }
+
+    /// a target that can't be reached is known without searching (unless the closest cell is wanted instead)
+    if (!answered && !options.closest_reachable_fallback && !pathing_map->reachable(key.from, key.to)) {
+        rejected_requests_++;
+        answered = true;
+        status = PathStatus::Unreachable;
+    }
+
+    /// build the clearance here (once per PathingMap version), so the workers share it instead of each building one
+    if (!answered && options.agent_size > 1) {
+        pathing_map->clearance_map();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::uint64_t ticket = ++last_ticket_;
+    latest_tickets_[requester] = ticket;
+
+    if (answered) {
+        /// an older request that is still queued won't be delivered anyway
+        auto queued = queued_jobs_.find(requester);
+        if (queued != queued_jobs_.end()) {
+            jobs_.erase(std::find(jobs_.begin(), jobs_.end(), queued->second));
+            queued_jobs_.erase(queued);
+        }
+        lock.unlock();
+        add_result({requester, ticket, key, path, status, callback, true});
+        return;
+    }
+
+    /// coalesce: a request still waiting in the queue is simply replaced (and keeps its place in the queue)
+    auto queued = queued_jobs_.find(requester);
+    if (queued != queued_jobs_.end()) {
+        *queued->second = {requester, ticket, key, pathing_map, start, end, options, callback};
+        return;
+    }
+
+    std::shared_ptr<Job> job(new Job{requester, ticket, key, pathing_map, start, end, options, callback});
+    jobs_.push_back(job);
+    queued_jobs_[requester] = job;
+    lock.unlock();
+    job_available_.notify_one();
+}
+
+/// Same as above, but searches in a copy of the specified PathingMap (which shares its filling until it changes).
+void PathService::request_path(const void *requester, const PathingMap &pathing_map, const QPointF &start,
+                               const QPointF &end, const PathingOptions &options, Callback callback) {
+    request_path(requester, std::make_shared<const PathingMap>(pathing_map), start, end, options, callback);
+}
+
+/// Drops the pending request of the specified requester (if any), its callback won't be called.
+void PathService::cancel(const void *requester) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    latest_tickets_.erase(requester);
+
+    auto queued = queued_jobs_.find(requester);
+    if (queued != queued_jobs_.end()) {
+        jobs_.erase(std::find(jobs_.begin(), jobs_.end(), queued->second));
+        queued_jobs_.erase(queued);
+    }
+}
+
+/// The loop of each worker thread: takes jobs off the queue and finds their paths until the service stops.
+void PathService::work() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            job = jobs_.front();
+            jobs_.pop_front();
+            queued_jobs_.erase(job->requester);
+        }
+
+        PathStatus status;
+        std::vector<QPointF> path = job->pathing_map->shortest_path(job->start, job->end, job->options, &status);
+        add_result({job->requester, job->ticket, job->key, path, status, job->callback, false});
+    }
+}
+
+/// Adds a result to the next batch, scheduling a deliver_results() if the batch was empty.
+void PathService::add_result(Result result) {
+    bool first_of_batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first_of_batch = results_.empty();
+        results_.push_back(std::move(result));
+    }
+    if (first_of_batch) {
+        QMetaObject::invokeMethod(this, "deliver_results", Qt::QueuedConnection);
+    }
+}
+
+/// Calls the callbacks of all the results that came in since the last batch, skipping the ones that were
+/// replaced by a newer request or cancelled.
+void PathService::deliver_results() {
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        results.swap(results_);
+    }
+
+    for (Result &result : results) {
+        /// running out of budget depends on the machine (and its load), so only caches final answers
+        if (!result.from_cache && result.status != PathStatus::BudgetExceeded) {
+            cache_.insert(result.key, result.path, result.status);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto latest = latest_tickets_.find(result.requester);
+            if (latest == latest_tickets_.end() || latest->second != result.ticket) {
+                continue;
+            }
+            latest_tickets_.erase(latest);
+        }
+        result.callback(result.path, result.status);
+    }
+}
@@ -0,0 +1,75 @@
+#include "PathingDebugOverlay.h"
+
+using namespace cute;
+
+PathingDebugOverlay::PathingDebugOverlay(const PathingMap &pathing_map) : pathing_map_(pathing_map) {
+    /// needed for option->exposedRect to be the rect that is actually repainted
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+/// Schedules the specified cells for repainting.
+void PathingDebugOverlay::cells_changed(const std::vector<Node> &cells) {
+    for (const Node &cell : cells) {
+        update(pathing_map_.cell_as_rect(cell));
+    }
+}
+
+/// Schedules the whole PathingMap for repainting.
+void PathingDebugOverlay::pathing_map_changed() { update(); }
+
+/// Replaces the Entity boxes that are drawn, the old and the new boxes are scheduled for repainting.
+void PathingDebugOverlay::set_entity_boxes(const std::vector<QPolygonF> &bounding_boxes,
+                                           const std::vector<QRectF> &pathing_bounds) {
+    update_entity_boxes();
+    entity_bounding_boxes_ = bounding_boxes;
+    entity_pathing_bounds_ = pathing_bounds;
+    update_entity_boxes();
+}
+
+/// Schedules the current Entity boxes for repainting (the outlines are one pixel wide, so a pixel around them too).
+void PathingDebugOverlay::update_entity_boxes() {
+    for (const QPolygonF &box : entity_bounding_boxes_) {
+        update(box.boundingRect().adjusted(-1, -1, 1, 1));
+    }
+    for (const QRectF &bounds : entity_pathing_bounds_) {
+        update(bounds.adjusted(-1, -1, 1, 1));
+    }
+}
+
+QRectF PathingDebugOverlay::boundingRect() const {
+    return QRectF(0, 0, pathing_map_.width(), pathing_map_.height()).adjusted(-1, -1, 1, 1);
+}
+
+void PathingDebugOverlay::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) {
+    Q_UNUSED(widget);
+
+    QRectF exposed = option->exposedRect;
+    Node top_left = pathing_map_.point_to_cell(exposed.topLeft());
+    Node bottom_right = pathing_map_.point_to_cell(exposed.bottomRight());
+
+    /// cells() leaves out the part of the exposed rect that is outside of the PathingMap
+    QColor filled_color(Qt::red);
+    filled_color.setAlphaF(0.25);
+    painter->setPen(QPen(Qt::red));
+    for (const Node &cell : pathing_map_.cells(top_left, bottom_right)) {
+        QRectF rect = pathing_map_.cell_as_rect(cell);
+        if (pathing_map_.filled(cell)) {
+            painter->fillRect(rect, filled_color);
+        }
+        painter->drawRect(rect);
+    }
+
+    painter->setPen(QPen(Qt::yellow));
+    for (const QRectF &bounds : entity_pathing_bounds_) {
+        if (bounds.intersects(exposed)) {
+            painter->drawRect(bounds);
+        }
+    }
+
+    painter->setPen(QPen(Qt::black));
+    for (const QPolygonF &box : entity_bounding_boxes_) {
+        if (box.boundingRect().intersects(exposed)) {
+            painter->drawPolygon(box);
+        }
+    }
+}
@@ -1,24 +1,86 @@
 #include "PathingMap.h"
-#include "Grid.h"
 #include "Utilities.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace cute;
 
-/// Fully transparent pixels count as "free" areas, other pixels count as "filled" areas.
-PathingMap::PathingMap(const QPixmap &pixmap, int cell_size) : cell_size_(cell_size) {
-    QImage image(pixmap.toImage());
-    int image_width = image.width();
-    int image_height = image.height();
+namespace {
+
+/// Calls `visit(x, y)` for every filled cell of the grid, reading the filling 64 cells at a time.
+template <typename Visit>
+void for_each_filled_cell(const PathGrid &grid, Visit visit) {
+    for (int y = 0, n = grid.num_rows(); y < n; y++) {
+        for (int x0 = 0, p = grid.num_cols(); x0 < p; x0 += 64) {
+            std::uint64_t bits = grid.row_bits(y, x0);
+            while (bits) {
+                visit(x0 + qCountTrailingZeroBits(bits), y);
+                bits &= bits - 1;
+            }
+        }
+    }
+}
+
+/// For every cell along one axis of a PathingMap whose cells are `source_cell_size` big and whose first cell
+/// starts at `origin` (in pixels), the first and last cells along the same axis of a PathingMap whose cells are
+/// `cell_size` big that the cell covers.
+void map_cells(int num_cells, int source_cell_size, double origin, int cell_size, std::vector<int> &first,
+               std::vector<int> &last) {
+    first.resize(num_cells);
+    last.resize(num_cells);
+    for (int i = 0; i < num_cells; i++) {
+        double start = origin + i * source_cell_size;
+        first[i] = static_cast<int>(std::floor(start / cell_size));
+        last[i] = static_cast<int>(std::floor((start + source_cell_size - 1) / cell_size));
+    }
+}
+
+/// Returns true if any of the specified ARGB32 pixels has a non zero alpha, 4 pixels at a time where SSE2 is
+/// available.
+bool any_opaque(const quint32 *pixels, int count) {
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i alphas = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + i)), alpha_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(alphas, zero)) != 0xffff) {
+            return true;
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        if (qAlpha(pixels[i]) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
 
-    num_cells_wide_ = image_width / cell_size;
-    num_cells_long_ = image_height / cell_size;
+/// Fully transparent pixels count as "free" areas, other pixels count as "filled" areas.
+///
+/// A cell is filled if any of its pixels is not fully transparent. The image is converted to 32 bit ARGB once
+/// and read a row at a time, so building PathingMaps for many images is cheap.
+/// Pixels past the last whole cell (if the size of the image isn't a multiple of the cell size) are ignored.
+PathingMap::PathingMap(const QPixmap &pixmap, int cell_size) : cell_size_(cell_size), version_(new_version()) {
+    assert(cell_size > 0);
+    QImage image(pixmap.toImage().convertToFormat(QImage::Format_ARGB32));
+
+    num_cells_wide_ = image.width() / cell_size;
+    num_cells_long_ = image.height() / cell_size;
     path_grid_ = PathGrid(num_cells_wide_, num_cells_long_);
 
-    Grid grid(num_cells_wide_, num_cells_long_, cell_size, cell_size);
-    for (int y = 0; y < image_height; y += 8) {
-        for (int x = 0; x < image_width; x += 8) {
-            if (qAlpha(image.pixel(x, y)) != 0) {
-                fill(grid.point_to_cell(QPointF(x, y)));
+    for (int y = 0, n = num_cells_long_ * cell_size; y < n; y++) {
+        const quint32 *row = reinterpret_cast<const quint32 *>(image.constScanLine(y));
+        int cell_y = y / cell_size;
+        for (int cell_x = 0; cell_x < num_cells_wide_; cell_x++) {
+            /// a cell already filled by an upper row of its pixels doesn't need to be looked at again
+            if (!path_grid_.filled(cell_x, cell_y) && any_opaque(row + cell_x * cell_size, cell_size)) {
+                path_grid_.fill(cell_x, cell_y);
             }
         }
     }
@@ -26,9 +88,23 @@ PathingMap::PathingMap(const QPixmap &pixmap, int cell_size) : cell_size_(cell_s
 
 PathingMap::PathingMap(int num_cells_wide, int num_cells_long, int cell_size)
         : path_grid_(num_cells_wide, num_cells_long), num_cells_wide_(num_cells_wide), num_cells_long_(num_cells_long),
-          cell_size_(cell_size) {}
+          cell_size_(cell_size), version_(new_version()) {}
+
+PathingMap::PathingMap() : num_cells_wide_(0), num_cells_long_(0), cell_size_(0), version_(new_version()) {}
 
-PathingMap::PathingMap() : num_cells_wide_(0), num_cells_long_(0), cell_size_(0) {}
+/// Returns a version number that was never returned before (by any thread).
+std::uint64_t PathingMap::new_version() {
+    static std::atomic<std::uint64_t> last_version(0);
+    return ++last_version;
+}
+
+/// Moves to a new version after the filling changed, the ConnectedComponents no longer match it.
+void PathingMap::filling_changed() {
+    version_ = new_version();
+    components_.reset();
+    clearance_.reset();
+    row_prefix_counts_.reset();
+}
 
 /// Big O is n^2.
 std::vector<Node> PathingMap::cells(const Node &top_left, const Node &bottom_right) const {
@@ -79,27 +155,95 @@ bool PathingMap::filled(const Node &cell) const { return path_grid_.filled(cell)
 bool PathingMap::filled(const QPointF &point) const { return filled(point_to_cell(point)); }
 
 /// if `checker(node)` on all elements in the region return true, this function return true
+///
+/// The cells are visited column by column (in the order of cells()) without collecting them first. The checker
+/// may look at anything, not only the filling, so it still runs once per cell: region checks of the filling
+/// itself are answered by the RowPrefixCounts instead (see filled(QRectF) and free(QRectF)).
 bool PathingMap::check_cells_in_region(const QRectF &region, std::function<bool(Node &)> checker) const {
-    for (Node cell : cells(region)) {
-        if (!checker(cell)) {
-            return false;
+    Node top_left = point_to_cell(region.topLeft());
+    Node bottom_right = point_to_cell(region.bottomRight());
+    int x1 = std::min(bottom_right.x(), num_cells_wide_ - 1);
+    int y1 = std::min(bottom_right.y(), num_cells_long_ - 1);
+    for (int x = std::max(top_left.x(), 0); x <= x1; x++) {
+        for (int y = std::max(top_left.y(), 0); y <= y1; y++) {
+            Node cell(x, y);
+            if (!checker(cell)) {
+                return false;
+            }
         }
     }
     return true;
 }
 
 /// Returns true if *all* the cells intersecting with the region are filled.
+/// O(rows of the region) once the RowPrefixCounts are built (see row_prefix_counts()).
 bool PathingMap::filled(const QRectF &region) const {
-    return check_cells_in_region(region, [this](Node &cell) { return filled(cell); });
+    Node top_left = point_to_cell(region.topLeft());
+    Node bottom_right = point_to_cell(region.bottomRight());
+
+    /// only the cells inside this PathingMap count
+    int num_cols = std::min(bottom_right.x(), num_cells_wide_ - 1) - std::max(top_left.x(), 0) + 1;
+    int num_rows = std::min(bottom_right.y(), num_cells_long_ - 1) - std::max(top_left.y(), 0) + 1;
+    if (num_cols <= 0 || num_rows <= 0) {
+        return true;
+    }
+    return num_filled(top_left, bottom_right) == num_cols * num_rows;
 }
 
 /// Returns true if *all* the cells intersectiong the region are free (not filled).
+/// O(rows of the region) once the RowPrefixCounts are built (see row_prefix_counts()).
 bool PathingMap::free(const QRectF &region) const {
-    return check_cells_in_region(region, [this](Node &cell) { return !filled(cell); });
+    return num_filled(point_to_cell(region.topLeft()), point_to_cell(region.bottomRight())) == 0;
+}
+
+/// Returns true if a path from `from_cell` to `to_cell` exists (i.e. shortest_path() won't come back empty,
+/// unless the cells are the same). O(1) once the ConnectedComponents are built.
+bool PathingMap::reachable(const Node &from_cell, const Node &to_cell) const {
+    return connected_components().reachable(from_cell, to_cell);
+}
+
+bool PathingMap::reachable(const QPointF &from_pt, const QPointF &to_pt) const {
+    return reachable(point_to_cell(from_pt), point_to_cell(to_pt));
+}
+
+/// Returns the ConnectedComponents of the current filling, building them if needed.
+/// Copies made afterwards share them, so build them before handing out copies that will call reachable().
+const ConnectedComponents &PathingMap::connected_components() const {
+    if (components_ == nullptr) {
+        components_ = std::make_shared<ConnectedComponents>(path_grid_);
+    }
+    return *components_;
 }
 
-std::vector<QPointF> PathingMap::shortest_path(const Node &from_cell, const Node &to_cell) const {
-    std::vector<Node> path = path_grid_.shortest_path(from_cell, to_cell);
+/// Returns the clearance of every cell (see ClearanceMap), built on first use after the filling changed.
+const ClearanceMap &PathingMap::clearance_map() const {
+    if (clearance_ == nullptr) {
+        clearance_ = std::make_shared<ClearanceMap>(path_grid_);
+    }
+    return *clearance_;
+}
+
+/// Returns the number of filled cells left of every cell in its row (see RowPrefixCounts), built on first use
+/// after the filling changed.
+const RowPrefixCounts &PathingMap::row_prefix_counts() const {
+    if (row_prefix_counts_ == nullptr) {
+        row_prefix_counts_ = std::make_shared<RowPrefixCounts>(path_grid_);
+    }
+    return *row_prefix_counts_;
+}
+
+/// Returns the number of filled cells in the region, both corners inclusive (cells outside don't count).
+int PathingMap::num_filled(const Node &top_left, const Node &bottom_right) const {
+    return row_prefix_counts().num_filled(top_left, bottom_right);
+}
+
+/// Returns the shortest path between the specified cells, as the points of its cells.
+/// If `status` is given, it is set to how the search ended (see PathStatus).
+std::vector<QPointF> PathingMap::shortest_path(const Node &from_cell, const Node &to_cell,
+                                               const PathingOptions &options, PathStatus *status) const {
+    /// this may run on a worker thread, so the clearance is only used (not built) here, and only when needed
+    const ClearanceMap *clearance = (options.agent_size > 1) ? clearance_.get() : nullptr;
+    std::vector<Node> path = path_grid_.shortest_path(from_cell, to_cell, options, status, clearance);
     /// scale them up into points
     std::vector<QPointF> points;
     for (Node node : path) {
@@ -108,8 +252,9 @@ std::vector<QPointF> PathingMap::shortest_path(const Node &from_cell, const Node
     return points;
 }
 
-std::vector<QPointF> PathingMap::shortest_path(const QPointF &p1, const QPointF &p2) const {
-    return shortest_path(point_to_cell(p1), point_to_cell(p2));
+std::vector<QPointF> PathingMap::shortest_path(const QPointF &p1, const QPointF &p2,
+                                               const PathingOptions &options, PathStatus *status) const {
+    return shortest_path(point_to_cell(p1), point_to_cell(p2), options, status);
 }
 
 Node PathingMap::point_to_cell(const QPointF &point) const {
@@ -123,34 +268,53 @@ QPointF PathingMap::cell_to_point(const Node &cell) const {
 /// Returns true if the specified PathingMap can fit in this PathingMap at the specified position.
 /// Basically, places the specified PathingMap in this PathingMap at the specified position
 /// and sees if it "fits" there without any collision between the filled cells of the two PathingMaps.
+///
+/// With the same cell sizes, the rows of the specified PathingMap are tested against the rows of this one
+/// 64 cells at a time (a shift and an AND per word). Otherwise, the cells each filled cell covers are counted
+/// with the RowPrefixCounts.
 bool PathingMap::can_fit(const PathingMap &specified_pathing_map, const QPointF &specified_pos) const {
     if (!contains(specified_pos)) {
         return false;
     }
-    /// get only the filled cells
-    std::vector<QRectF> filled_cells_as_rects;
-    for (QRectF rect : specified_pathing_map.cells_as_rects()) {
-        if (specified_pathing_map.filled(rect)) {
-            filled_cells_as_rects.push_back(rect);
-        }
-    }
-
-    /// shift them so they're on the specified_pos on this PathingMap
-    std::vector<QRectF> shifted_cells;
-    for (QRectF rect : filled_cells_as_rects) {
-        rect.moveTopLeft(QPointF(specified_pos.x() + rect.x(), specified_pos.y() + rect.y()));
-        shifted_cells.push_back(rect);
+    const PathGrid &probe = specified_pathing_map.path_grid_;
+
+    if (specified_pathing_map.cell_size_ != cell_size_) {
+        std::vector<int> first_col, last_col, first_row, last_row;
+        map_cells(specified_pathing_map.num_cells_wide_, specified_pathing_map.cell_size_, specified_pos.x(),
+                  cell_size_, first_col, last_col);
+        map_cells(specified_pathing_map.num_cells_long_, specified_pathing_map.cell_size_, specified_pos.y(),
+                  cell_size_, first_row, last_row);
+        bool fits = true;
+        for_each_filled_cell(probe, [&](int x, int y) {
+            fits = fits && num_filled(Node(first_col[x], first_row[y]), Node(last_col[x], last_row[y])) == 0;
+        });
+        return fits;
     }
 
-    /// if any filled cells intersect with the shifted_cells, return false
-    for (QRectF shifted_rect : shifted_cells) {
-        for (Node cell : cells(shifted_rect)) {
-            if (filled(cell)) {
+    /// unless the position is on a cell corner, each filled cell also covers the cell right of (and below) the
+    /// one its top left corner is in, so the rows are widened by a column (and tested against two rows)
+    Node origin = point_to_cell(specified_pos);
+    Node far_corner = point_to_cell(specified_pos + QPointF(cell_size_ - 1, cell_size_ - 1));
+    bool covers_right = far_corner.x() > origin.x();
+    bool covers_below = far_corner.y() > origin.y();
+
+    for (int y = 0, n = probe.num_rows(); y < n; y++) {
+        for (int x0 = 0, p = probe.num_cols() + covers_right; x0 < p; x0 += 64) {
+            std::uint64_t row_mask = probe.row_bits(y, x0);
+            if (covers_right) {
+                row_mask |= probe.row_bits(y, x0 - 1);
+            }
+            if (row_mask == 0) {
+                continue;
+            }
+            if (path_grid_.row_bits(origin.y() + y, origin.x() + x0) & row_mask) {
+                return false;
+            }
+            if (covers_below && (path_grid_.row_bits(origin.y() + y + 1, origin.x() + x0) & row_mask)) {
                 return false;
             }
         }
     }
-
     return true;
 }
 
@@ -158,14 +322,13 @@ bool PathingMap::contains(const QPointF &pos) const {
     return pos.x() > 0 && pos.y() > 0 && pos.x() < width() && pos.y() < height();
 }
 
-void PathingMap::fill(const Node &cell) { path_grid_.fill(cell); }
+void PathingMap::fill(const Node &cell) { change_filling({cell}, {}); }
 
 void PathingMap::fill(const QPointF &point) { fill(point_to_cell(point)); }
 
 void PathingMap::fill(const Node &top_left, const Node &bottom_right) {
-    for (Node cell : cells(top_left, bottom_right)) {
-        fill(cell);
-    }
+    path_grid_.fill(top_left, bottom_right);
+    filling_changed();
 }
 
 void PathingMap::fill(const QPointF &top_left, const QPointF &bottom_right) {
@@ -174,16 +337,18 @@ void PathingMap::fill(const QPointF &top_left, const QPointF &bottom_right) {
 
 void PathingMap::fill(const QRectF &region) { fill(region.topLeft(), region.bottomRight()); }
 
-void PathingMap::fill() { path_grid_.fill(); }
+void PathingMap::fill() {
+    path_grid_.fill();
+    filling_changed();
+}
 
-void PathingMap::unfill(const Node &cell) { path_grid_.unfill(cell); }
+void PathingMap::unfill(const Node &cell) { change_filling({}, {cell}); }
 
 void PathingMap::unfill(const QPointF &point) { unfill(point_to_cell(point)); }
 
 void PathingMap::unfill(const Node &top_left, const Node &bottom_right) {
-    for (Node cell : cells(top_left, bottom_right)) {
-        unfill(cell);
-    }
+    path_grid_.unfill(top_left, bottom_right);
+    filling_changed();
 }
 
 void PathingMap::unfill(const QPointF &top_left, const QPointF &bottom_right) {
@@ -192,14 +357,87 @@ void PathingMap::unfill(const QPointF &top_left, const QPointF &bottom_right) {
 
 void PathingMap::unfill(const QRectF &region) { unfill(region.topLeft(), region.bottomRight()); }
 
-void PathingMap::unfill() { path_grid_.unfill(); }
+void PathingMap::unfill() {
+    path_grid_.unfill();
+    filling_changed();
+}
+
+/// Fills and unfills the specified cells (no cell may be in both), moving to a single new version.
+///
+/// The RowPrefixCounts (if built) only count the changed rows again, the ClearanceMap (if built) only computes
+/// the clearance around the changed cells again (see ClearanceMap::update()). Unfilling a cell can only join areas
+/// and filling one rarely splits an area, so the ConnectedComponents (if built) are updated cell by cell instead of
+/// dropped, unless a filled cell may have split its area.
+void PathingMap::change_filling(const std::vector<Node> &cells_to_fill, const std::vector<Node> &cells_to_unfill) {
+    std::vector<int> changed_rows;
+    for (const Node &cell : cells_to_fill) {
+        path_grid_.fill(cell);
+        changed_rows.push_back(cell.y());
+    }
+    for (const Node &cell : cells_to_unfill) {
+        path_grid_.unfill(cell);
+        changed_rows.push_back(cell.y());
+    }
+    version_ = new_version();
+
+    if (clearance_ != nullptr) {
+        /// copy on write, like the labels below
+        if (clearance_.use_count() > 1) {
+            clearance_ = std::make_shared<ClearanceMap>(*clearance_);
+        }
+        clearance_->update(path_grid_, cells_to_fill);
+        clearance_->update(path_grid_, cells_to_unfill);
+    }
+
+    if (row_prefix_counts_ != nullptr) {
+        /// copy on write, like the labels below
+        if (row_prefix_counts_.use_count() > 1) {
+            row_prefix_counts_ = std::make_shared<RowPrefixCounts>(*row_prefix_counts_);
+        }
+        std::sort(changed_rows.begin(), changed_rows.end());
+        changed_rows.erase(std::unique(changed_rows.begin(), changed_rows.end()), changed_rows.end());
+        for (int y : changed_rows) {
+            if (y >= 0 && y < num_cells_long_) {
+                row_prefix_counts_->update_row(path_grid_, y);
+            }
+        }
+    }
+
+    if (components_ == nullptr) {
+        return;
+    }
+    /// copy on write, copies of this PathingMap still use the old labels
+    if (components_.use_count() > 1) {
+        components_ = std::make_shared<ConnectedComponents>(*components_);
+    }
+    for (const Node &cell : cells_to_unfill) {
+        if (path_grid_.contains(cell)) {
+            components_->unfill(path_grid_, cell);
+        }
+    }
+    for (const Node &cell : cells_to_fill) {
+        if (path_grid_.contains(cell) && !components_->fill(cell)) {
+            components_.reset();
+            return;
+        }
+    }
+}
 
 /// A value of 0 means unfilled, anything else means fill.
-void PathingMap::set_filling(const std::vector<std::vector<int>> &vec) { path_grid_.set_filling(vec); }
+void PathingMap::set_filling(const std::vector<std::vector<int>> &vec) {
+    path_grid_.set_filling(vec);
+    filling_changed();
+}
 
 /// This works best when the two PathingMaps have the same cell sizes. If the
 /// cell sizes are different, the resulting pathing is a little inaccurate.
 void PathingMap::set_filling(const PathingMap &another_pathmap, const QPointF &pos) {
+    if (another_pathmap.cell_size_ == cell_size_) {
+        path_grid_.set_filling(another_pathmap.path_grid_, point_to_cell(pos));
+        filling_changed();
+        return;
+    }
+
     QPointF fixed_pos(cell_to_point(point_to_cell(pos)));
 
     QRectF unfilled_region(fixed_pos.x(), fixed_pos.y(), another_pathmap.width(), another_pathmap.height());
@@ -212,21 +450,53 @@ void PathingMap::set_filling(const PathingMap &another_pathmap, const QPointF &p
 ///
 /// Adding a pathing map "blends" the two PathingMap's filled regions.
 /// In other words, the resulting PathingMap can be more filled but never less filled.
+///
+/// With the same cell sizes, the rows of the other PathingMap are ORed in a word at a time. Otherwise, every
+/// filled cell fills the (precomputed) span of cells it covers.
 void PathingMap::add_filling(const PathingMap &another_pathmap, const QPointF &pos) {
-    QPointF fixed_pos(cell_to_point(point_to_cell(pos)));
-
-    std::vector<QRectF> filled_little_rects;
-    for (QRectF rect : another_pathmap.cells_as_rects()) {
-        if (another_pathmap.filled(rect.topLeft())) {
-            rect.moveTopLeft(QPointF(fixed_pos.x() + rect.x(), fixed_pos.y() + rect.y()));
-            filled_little_rects.push_back(rect);
-        }
+    Node origin = point_to_cell(pos);
+    if (another_pathmap.cell_size_ == cell_size_) {
+        path_grid_.add_path_grid(another_pathmap.path_grid_, origin);
+        filling_changed();
+        return;
     }
 
-    /// the cell size of the another_pathmap may be different from this pathmap, so you need to re-invoke `cells`.
-    for (QRectF rect : filled_little_rects) {
-        for (Node cell : cells(rect)) {
-            fill(cell);
-        }
+    /// the cell size of the another_pathmap is different from this pathmap, so its cells cover spans of cells
+    std::vector<int> first_col, last_col, first_row, last_row;
+    map_cells(another_pathmap.num_cells_wide_, another_pathmap.cell_size_, origin.x() * cell_size_, cell_size_,
+              first_col, last_col);
+    map_cells(another_pathmap.num_cells_long_, another_pathmap.cell_size_, origin.y() * cell_size_, cell_size_,
+              first_row, last_row);
+    for_each_filled_cell(another_pathmap.path_grid_, [&](int x, int y) {
+        path_grid_.fill(Node(first_col[x], first_row[y]), Node(last_col[x], last_row[y]));
+    });
+    filling_changed();
+}
+
+/// Returns the cells of this PathingMap that add_filling() would fill for the specified PathingMap at the
+/// specified pos (cells outside of this PathingMap are left out). A cell may be in the vector more than once
+/// if the cell sizes of the two PathingMaps are different.
+std::vector<Node> PathingMap::footprint(const PathingMap &another_pathmap, const QPointF &pos) const {
+    Node origin = point_to_cell(pos);
+    std::vector<Node> footprint_cells;
+    if (another_pathmap.cell_size_ == cell_size_) {
+        for_each_filled_cell(another_pathmap.path_grid_, [&](int x, int y) {
+            Node cell(origin.x() + x, origin.y() + y);
+            if (path_grid_.contains(cell)) {
+                footprint_cells.push_back(cell);
+            }
+        });
+        return footprint_cells;
     }
+
+    std::vector<int> first_col, last_col, first_row, last_row;
+    map_cells(another_pathmap.num_cells_wide_, another_pathmap.cell_size_, origin.x() * cell_size_, cell_size_,
+              first_col, last_col);
+    map_cells(another_pathmap.num_cells_long_, another_pathmap.cell_size_, origin.y() * cell_size_, cell_size_,
+              first_row, last_row);
+    for_each_filled_cell(another_pathmap.path_grid_, [&](int x, int y) {
+        std::vector<Node> covered = cells(Node(first_col[x], first_row[y]), Node(last_col[x], last_row[y]));
+        footprint_cells.insert(footprint_cells.end(), covered.begin(), covered.end());
+    });
+    return footprint_cells;
 }
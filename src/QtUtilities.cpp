@@ -17,6 +17,107 @@ double distance(QPointF p1, QPointF p2) {
     return qAbs(qSqrt(qPow(deltaX, 2) + qPow(deltaY, 2)));
 }
 
+/// Returns true if the polygon is convex: every turn along it goes the same way, and it turns around exactly once
+/// (a self-intersecting polygon like a pentagram turns one way only, but around twice). Polygons with less than
+/// 3 points, and repeated points (e.g. the closing point of a closed polygon), are fine.
+bool is_convex(const QPolygonF &polygon) {
+    std::vector<QPointF> edges;
+    for (int i = 0, n = polygon.size(); i < n; i++) {
+        QPointF edge = polygon[(i + 1) % n] - polygon[i];
+        if (!edge.isNull()) {
+            edges.push_back(edge);
+        }
+    }
+
+    int n = edges.size();
+    int turn_sign = 0;
+    double total_turn = 0;
+    for (int i = 0; i < n; i++) {
+        const QPointF &edge1 = edges[i];
+        const QPointF &edge2 = edges[(i + 1) % n];
+        double cross = edge1.x() * edge2.y() - edge1.y() * edge2.x();
+        total_turn += qAtan2(cross, QPointF::dotProduct(edge1, edge2));
+        int sign = (cross > 0) - (cross < 0);
+        if (sign == 0) {
+            continue;
+        }
+        if (turn_sign != 0 && sign != turn_sign) {
+            return false;
+        }
+        turn_sign = sign;
+    }
+
+    /// the turns of a closed polygon add up to a whole number of times around (2 pi each)
+    return qAbs(total_turn) < 3 * M_PI;
+}
+
+namespace {
+
+/// Puts the smallest and biggest projection of the polygon's points onto the axis into `min`/`max`.
+void project(const QPolygonF &polygon, const QPointF &axis, double &min, double &max) {
+    min = std::numeric_limits<double>::max();
+    max = std::numeric_limits<double>::lowest();
+    for (const QPointF &point : polygon) {
+        double projection = QPointF::dotProduct(point, axis);
+        min = std::min(min, projection);
+        max = std::max(max, projection);
+    }
+}
+
+/// Returns true if the normal of an edge of `polygon` separates it from `other` (both convex).
+/// Projections that only touch count as separated, so polygons sharing an edge don't overlap.
+bool has_separating_axis(const QPolygonF &polygon, const QPolygonF &other) {
+    int n = polygon.size();
+    for (int i = 0; i < n; i++) {
+        QPointF edge = polygon[(i + 1) % n] - polygon[i];
+        if (edge.isNull()) {
+            continue;
+        }
+        QPointF axis(-edge.y(), edge.x());
+        double min1, max1, min2, max2;
+        project(polygon, axis, min1, max1);
+        project(other, axis, min2, max2);
+        if (max1 <= min2 || max2 <= min1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/// Returns true if the two polygons overlap (share some area, touching doesn't count).
+///
+/// The bounding rects are compared first. Convex polygons (which includes rotated rectangles, like the bounding
+/// boxes of Entities in a Map) are then tested with the separating axis theorem: they overlap unless the normal
+/// of an edge of either one separates them. Other polygons fall back to clipping them against each other.
+bool intersects(const QPolygonF &polygon1, const QPolygonF &polygon2) {
+    if (polygon1.isEmpty() || polygon2.isEmpty()) {
+        return false;
+    }
+    QRectF rect1 = polygon1.boundingRect();
+    QRectF rect2 = polygon2.boundingRect();
+    if (rect1.right() < rect2.left() || rect2.right() < rect1.left() || rect1.bottom() < rect2.top() ||
+        rect2.bottom() < rect1.top()) {
+        return false;
+    }
+
+    if (!is_convex(polygon1) || !is_convex(polygon2)) {
+        return !polygon1.intersected(polygon2).isEmpty();
+    }
+    return !has_separating_axis(polygon1, polygon2) && !has_separating_axis(polygon2, polygon1);
+}
+
+bool intersects(const QPolygonF &polygon, const QRectF &rect) { return intersects(polygon, QPolygonF(rect)); }
+
+/// Returns true if the point is inside the polygon (odd even fill), checking the bounding rect first.
+bool contains(const QPolygonF &polygon, const QPointF &point) {
+    if (!polygon.boundingRect().contains(point)) {
+        return false;
+    }
+    return polygon.containsPoint(point, Qt::OddEvenFill);
+}
+
 } // namespace QtUtils
 
 } // namespace cute
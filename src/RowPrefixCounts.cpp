@@ -0,0 +1,52 @@
+#include "RowPrefixCounts.h"
+
+using namespace cute;
+
+RowPrefixCounts::RowPrefixCounts(const PathGrid &grid) : num_cols_(grid.num_cols()), num_rows_(grid.num_rows()) {
+    counts_.assign(static_cast<size_t>(num_cols_ + 1) * num_rows_, 0);
+    for (int y = 0; y < num_rows_; y++) {
+        update_row(grid, y);
+    }
+}
+
+/// Counts the specified row of `grid` (which must have the size the counts were built for) again, after some of
+/// its cells changed. The filling is read a word at a time and the words with no filled cells are counted
+/// with a single fill of their entries.
+void RowPrefixCounts::update_row(const PathGrid &grid, int y) {
+    assert(grid.num_cols() == num_cols_ && grid.num_rows() == num_rows_);
+    assert(y >= 0 && y < num_rows_);
+
+    int *counts = &counts_[static_cast<size_t>(y) * (num_cols_ + 1)];
+    int row_count = 0;
+    for (int x0 = 0; x0 < num_cols_; x0 += 64) {
+        std::uint64_t bits = grid.row_bits(y, x0);
+        int n = std::min(x0 + 64, num_cols_);
+        if (bits == 0) {
+            std::fill(counts + x0 + 1, counts + n + 1, row_count);
+            continue;
+        }
+        for (int x = x0; x < n; x++) {
+            row_count += (bits >> (x - x0)) & 1;
+            counts[x + 1] = row_count;
+        }
+    }
+}
+
+/// Returns the number of filled cells in the region, both corners inclusive. The parts of the region outside of
+/// the grid count as unfilled.
+int RowPrefixCounts::num_filled(const Node &top_left, const Node &bottom_right) const {
+    int x0 = std::max(top_left.x(), 0);
+    int y0 = std::max(top_left.y(), 0);
+    int x1 = std::min(bottom_right.x(), num_cols_ - 1);
+    int y1 = std::min(bottom_right.y(), num_rows_ - 1);
+    if (x0 > x1 || y0 > y1) {
+        return 0;
+    }
+
+    int stride = num_cols_ + 1;
+    int num = 0;
+    for (int y = y0; y <= y1; y++) {
+        num += counts_[static_cast<size_t>(y) * stride + x1 + 1] - counts_[static_cast<size_t>(y) * stride + x0];
+    }
+    return num;
+}
@@ -19,8 +19,10 @@ void cute::add_random_trees(Map *map, int nums_to_add, int num_images) {
 int trim_to_gap(int value, int gap) { return value - (value % gap); }
 
 void cute::add_random_tree(Map *map, int num_images) {
-    std::string full_path = ":/cute-engine-builtin/resources/graphics/tree/tree_pathing.png";
-    PathingMap *pm = new PathingMap(QPixmap(full_path.c_str()), 32);
+    /// every tree has the same pathing, only read the image once (the copies share its filling)
+    static const PathingMap tree_pathing_map(QPixmap(":/cute-engine-builtin/resources/graphics/tree/tree_pathing.png"),
+                                             32);
+    PathingMap *pm = new PathingMap(tree_pathing_map);
     RandomImageEntity *tree =
             new RandomImageEntity(":/cute-engine-builtin/resources/graphics/tree", "tree", num_images, *pm);
     tree->add_tag("scenery");